@@ -8,4 +8,30 @@
 #include "vertex_array.hpp"
 #include "state.hpp"
 #include "command.hpp"
-#include "managment.hpp"
\ No newline at end of file
+#include "managment.hpp"
+#include "parallel.hpp"
+#include "compression.hpp"
+#include "mapped_file.hpp"
+#include "texture_file.hpp"
+#include "texture_pool.hpp"
+#include "sampler_cache.hpp"
+#include "resource_table.hpp"
+#include "framebuffer.hpp"
+#include "render_graph.hpp"
+#include "compute_primitives.hpp"
+#include "downsampler.hpp"
+#include "culling.hpp"
+#include "dispatch_chain.hpp"
+#include "query.hpp"
+#include "sync.hpp"
+#include "gltf_scene.hpp"
+#include "mesh_optimizer.hpp"
+#include "lod.hpp"
+#include "pipeline_state.hpp"
+#include "pipeline_cache.hpp"
+#include "shader_variants.hpp"
+#include "gl_worker.hpp"
+#include "draw_constants.hpp"
+#include "instancing.hpp"
+#include "batch_culling.hpp"
+#include "sprite_batch.hpp"
\ No newline at end of file
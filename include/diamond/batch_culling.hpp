@@ -0,0 +1,307 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "parallel.hpp"
+#include "culling.hpp"
+#include <glm/simd/platform.h>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace NS_NAME {
+
+    // float lanes for batch kernels, native is widest set enabled at compile time (GLM_ARCH)
+    // kernels are written once over lane type, tails run on scalar
+    namespace simd_lanes {
+
+        struct scalar {
+            static constexpr size_t width = 1;
+            float v;
+
+            static scalar load(const float * p) { return { *p }; }
+            static scalar set(float f) { return { f }; }
+            void store(float * p) const { *p = v; }
+
+            scalar operator+(scalar o) const { return { v + o.v }; }
+            scalar operator-(scalar o) const { return { v - o.v }; }
+            scalar operator*(scalar o) const { return { v * o.v }; }
+            static scalar abs(scalar a) { return { std::fabs(a.v) }; }
+            static scalar max(scalar a, scalar b) { return { std::max(a.v, b.v) }; }
+            static scalar sqrt(scalar a) { return { std::sqrt(a.v) }; }
+
+            // bit i set where a < b in lane i
+            static unsigned less(scalar a, scalar b) { return a.v < b.v ? 1u : 0u; }
+        };
+
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+        struct avx2 {
+            static constexpr size_t width = 8;
+            __m256 v;
+
+            static avx2 load(const float * p) { return { _mm256_loadu_ps(p) }; }
+            static avx2 set(float f) { return { _mm256_set1_ps(f) }; }
+            void store(float * p) const { _mm256_storeu_ps(p, v); }
+
+            avx2 operator+(avx2 o) const { return { _mm256_add_ps(v, o.v) }; }
+            avx2 operator-(avx2 o) const { return { _mm256_sub_ps(v, o.v) }; }
+            avx2 operator*(avx2 o) const { return { _mm256_mul_ps(v, o.v) }; }
+            static avx2 abs(avx2 a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v) }; }
+            static avx2 max(avx2 a, avx2 b) { return { _mm256_max_ps(a.v, b.v) }; }
+            static avx2 sqrt(avx2 a) { return { _mm256_sqrt_ps(a.v) }; }
+            static unsigned less(avx2 a, avx2 b) { return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ))); }
+        };
+        using native = avx2;
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+        struct sse {
+            static constexpr size_t width = 4;
+            __m128 v;
+
+            static sse load(const float * p) { return { _mm_loadu_ps(p) }; }
+            static sse set(float f) { return { _mm_set1_ps(f) }; }
+            void store(float * p) const { _mm_storeu_ps(p, v); }
+
+            sse operator+(sse o) const { return { _mm_add_ps(v, o.v) }; }
+            sse operator-(sse o) const { return { _mm_sub_ps(v, o.v) }; }
+            sse operator*(sse o) const { return { _mm_mul_ps(v, o.v) }; }
+            static sse abs(sse a) { return { _mm_andnot_ps(_mm_set1_ps(-0.f), a.v) }; }
+            static sse max(sse a, sse b) { return { _mm_max_ps(a.v, b.v) }; }
+            static sse sqrt(sse a) { return { _mm_sqrt_ps(a.v) }; }
+            static unsigned less(sse a, sse b) { return unsigned(_mm_movemask_ps(_mm_cmplt_ps(a.v, b.v))); }
+        };
+        using native = sse;
+#else
+        using native = scalar;
+#endif
+
+        // fn(lane_tag, first) over [begin, end), native lanes then scalar tail
+        template<class F>
+        void for_each(size_t begin, size_t end, F&& fn) {
+            size_t i = begin;
+            for (; i + native::width <= end; i += native::width) fn(native(), i);
+            for (; i < end; i++) fn(scalar(), i);
+        }
+    };
+
+
+    // affine instance transforms and local bounds as structure of arrays (lane i of every array is instance i)
+    struct instance_soa {
+        std::vector<float> m[12];     // m[column * 3 + row], last row is (0, 0, 0, 1)
+        std::vector<float> center[3]; // local bounds
+        std::vector<float> extent[3]; // half size, sphere of radius r is stored as extent (r, r, r)
+        std::vector<uint32_t> id;
+
+        size_t size() const {
+            return id.size();
+        }
+
+        void resize(size_t count) {
+            for (auto& a : m) a.resize(count);
+            for (auto& a : center) a.resize(count);
+            for (auto& a : extent) a.resize(count);
+            id.resize(count);
+        }
+
+        void set(size_t i, const glm::mat4& transform, const glm::vec3& box_center, const glm::vec3& box_extent, uint32_t instance_id) {
+            for (int c = 0; c < 4; c++) for (int r = 0; r < 3; r++) m[c * 3 + r][i] = transform[c][r];
+            for (int k = 0; k < 3; k++) {
+                center[k][i] = box_center[k];
+                extent[k][i] = box_extent[k];
+            }
+            id[i] = instance_id;
+        }
+
+        void set_sphere(size_t i, const glm::mat4& transform, const glm::vec4& sphere, uint32_t instance_id) {
+            this->set(i, transform, glm::vec3(sphere), glm::vec3(sphere.w), instance_id);
+        }
+
+        glm::mat4 transform(size_t i) const {
+            glm::mat4 t(1.f);
+            for (int c = 0; c < 4; c++) for (int r = 0; r < 3; r++) t[c][r] = m[c * 3 + r][i];
+            return t;
+        }
+    };
+
+
+    namespace batch_kernels {
+
+        // out = parent * in for transforms [begin, end), parent is affine, out may be in (bounds and ids are not touched)
+        void multiply(const glm::mat4& parent, const instance_soa& in, instance_soa& out, size_t begin, size_t end) {
+            simd_lanes::for_each(begin, end, [&](auto tag, size_t i) {
+                using V = decltype(tag);
+                V p[12];
+                for (int c = 0; c < 4; c++) for (int r = 0; r < 3; r++) p[c * 3 + r] = V::set(parent[c][r]);
+                for (int c = 0; c < 4; c++) {
+                    const V x = V::load(&in.m[c * 3 + 0][i]);
+                    const V y = V::load(&in.m[c * 3 + 1][i]);
+                    const V z = V::load(&in.m[c * 3 + 2][i]);
+                    for (int r = 0; r < 3; r++) {
+                        V v = p[r] * x + p[3 + r] * y + p[6 + r] * z;
+                        if (c == 3) v = v + p[9 + r];
+                        v.store(&out.m[c * 3 + r][i]);
+                    }
+                }
+            });
+        }
+
+        // transforms of [begin, end) as 4 column arrays (instancing stream layout), arrays are indexed from begin
+        void pack_columns(const instance_soa& in, size_t begin, size_t end, glm::vec4 * columns[4]) {
+            simd_lanes::for_each(begin, end, [&](auto tag, size_t i) {
+                using V = decltype(tag);
+                float lanes[3][V::width];
+                for (int c = 0; c < 4; c++) {
+                    for (int r = 0; r < 3; r++) V::load(&in.m[c * 3 + r][i]).store(lanes[r]);
+                    const float w = c == 3 ? 1.f : 0.f;
+                    glm::vec4 * dst = columns[c] + (i - begin);
+                    for (size_t k = 0; k < V::width; k++) dst[k] = glm::vec4(lanes[0][k], lanes[1][k], lanes[2][k], w);
+                }
+            });
+        }
+
+        // world space boxes (center, half size) of [begin, end), arrays are indexed from begin
+        void world_boxes(const instance_soa& in, size_t begin, size_t end, float * center[3], float * extent[3]) {
+            simd_lanes::for_each(begin, end, [&](auto tag, size_t i) {
+                using V = decltype(tag);
+                const V c[3] = { V::load(&in.center[0][i]), V::load(&in.center[1][i]), V::load(&in.center[2][i]) };
+                const V e[3] = { V::load(&in.extent[0][i]), V::load(&in.extent[1][i]), V::load(&in.extent[2][i]) };
+                for (int r = 0; r < 3; r++) {
+                    const V m0 = V::load(&in.m[0 + r][i]), m1 = V::load(&in.m[3 + r][i]), m2 = V::load(&in.m[6 + r][i]);
+                    (m0 * c[0] + m1 * c[1] + m2 * c[2] + V::load(&in.m[9 + r][i])).store(center[r] + (i - begin));
+                    (V::abs(m0) * e[0] + V::abs(m1) * e[1] + V::abs(m2) * e[2]).store(extent[r] + (i - begin));
+                }
+            });
+        }
+
+        // world space bounding spheres of [begin, end), radius grows by largest axis scale
+        void world_spheres(const instance_soa& in, size_t begin, size_t end, float * center[3], float * radius) {
+            simd_lanes::for_each(begin, end, [&](auto tag, size_t i) {
+                using V = decltype(tag);
+                const V c[3] = { V::load(&in.center[0][i]), V::load(&in.center[1][i]), V::load(&in.center[2][i]) };
+                V scale = V::set(0.f);
+                for (int k = 0; k < 3; k++) {
+                    const V x = V::load(&in.m[k * 3 + 0][i]), y = V::load(&in.m[k * 3 + 1][i]), z = V::load(&in.m[k * 3 + 2][i]);
+                    scale = V::max(scale, x * x + y * y + z * z);
+                }
+                for (int r = 0; r < 3; r++) {
+                    (V::load(&in.m[0 + r][i]) * c[0] + V::load(&in.m[3 + r][i]) * c[1] + V::load(&in.m[6 + r][i]) * c[2] + V::load(&in.m[9 + r][i])).store(center[r] + (i - begin));
+                }
+                const V local = V::max(V::load(&in.extent[0][i]), V::max(V::load(&in.extent[1][i]), V::load(&in.extent[2][i])));
+                (local * V::sqrt(scale)).store(radius + (i - begin));
+            });
+        }
+
+        // indices of instances in [begin, end) whose world box is not outside any plane, returns count
+        size_t cull(const glm::vec4 planes[6], const instance_soa& in, size_t begin, size_t end, uint32_t * survivors) {
+            size_t count = 0;
+            simd_lanes::for_each(begin, end, [&](auto tag, size_t i) {
+                using V = decltype(tag);
+                V c[3], e[3];
+                const V lc[3] = { V::load(&in.center[0][i]), V::load(&in.center[1][i]), V::load(&in.center[2][i]) };
+                const V le[3] = { V::load(&in.extent[0][i]), V::load(&in.extent[1][i]), V::load(&in.extent[2][i]) };
+                for (int r = 0; r < 3; r++) {
+                    const V m0 = V::load(&in.m[0 + r][i]), m1 = V::load(&in.m[3 + r][i]), m2 = V::load(&in.m[6 + r][i]);
+                    c[r] = m0 * lc[0] + m1 * lc[1] + m2 * lc[2] + V::load(&in.m[9 + r][i]);
+                    e[r] = V::abs(m0) * le[0] + V::abs(m1) * le[1] + V::abs(m2) * le[2];
+                }
+
+                unsigned outside = 0;
+                for (int p = 0; p < 6; p++) {
+                    const V nx = V::set(planes[p].x), ny = V::set(planes[p].y), nz = V::set(planes[p].z);
+                    const V distance = nx * c[0] + ny * c[1] + nz * c[2] + V::set(planes[p].w);
+                    const V radius = V::abs(nx) * e[0] + V::abs(ny) * e[1] + V::abs(nz) * e[2];
+                    outside |= V::less(distance + radius, V::set(0.f));
+                }
+
+                for (size_t k = 0; k < V::width; k++) {
+                    if (!(outside & (1u << k))) survivors[count++] = uint32_t(i + k);
+                }
+            });
+            return count;
+        }
+    };
+
+
+    // out = parent * in for all instances on pool, out takes bounds and ids of in
+    void batch_multiply(const glm::mat4& parent, const instance_soa& in, instance_soa& out, thread_pool& pool = default_pool(), size_t grain = 16384) {
+        if (&out != &in) {
+            out.resize(in.size());
+            for (int k = 0; k < 3; k++) {
+                out.center[k] = in.center[k];
+                out.extent[k] = in.extent[k];
+            }
+            out.id = in.id;
+        }
+        pool.parallel_for(0, in.size(), grain, [&](size_t begin, size_t end) {
+            batch_kernels::multiply(parent, in, out, begin, end);
+        });
+    }
+
+
+    struct batch_cull_stats {
+        size_t tested = 0;
+        size_t visible = 0;  // survivors found
+        size_t written = 0;  // survivors stored (capped by capacity)
+    };
+
+
+    // multithreaded frustum culling of instance_soa, survivors are written in instance order
+    // output is typically mapped instance buffer (ring_buffer allocation), written sequentially per chunk
+    class batch_culler {
+    protected:
+        size_t grain;
+        std::vector<std::vector<uint32_t>> chunks; // survivor indices per chunk
+        std::vector<size_t> counts, offsets;
+        batch_cull_stats counters;
+
+    public:
+        batch_culler(size_t grain = 16384) : grain(std::max(grain, size_t(64))) {}
+
+        // transforms (mat4 each) and ids may be null, returns number written (at most capacity)
+        size_t cull(const instance_soa& in, const glm::mat4& view_proj, glm::mat4 * transforms, uint32_t * ids, size_t capacity, thread_pool& pool = default_pool()) {
+            glm::vec4 planes[6];
+            gpu_culler::frustum_planes(view_proj, planes);
+
+            const size_t count = in.size();
+            const size_t chunk_count = (count + grain - 1) / grain;
+            if (chunks.size() < chunk_count) chunks.resize(chunk_count);
+            counts.assign(chunk_count, 0);
+            offsets.assign(chunk_count, 0);
+
+            pool.parallel_for(0, count, grain, [&](size_t begin, size_t end) {
+                auto& list = chunks[begin / grain];
+                list.resize(end - begin);
+                counts[begin / grain] = batch_kernels::cull(planes, in, begin, end, list.data());
+            });
+
+            size_t total = 0;
+            for (size_t c = 0; c < chunk_count; c++) {
+                offsets[c] = total;
+                total += counts[c];
+            }
+            const size_t written = std::min(total, capacity);
+
+            pool.parallel_for(0, chunk_count, 1, [&](size_t first, size_t last) {
+                for (size_t c = first; c < last; c++) {
+                    const uint32_t * list = chunks[c].data();
+                    const size_t n = std::min(counts[c], written - std::min(written, offsets[c]));
+                    for (size_t k = 0; k < n; k++) {
+                        const size_t at = offsets[c] + k;
+                        if (transforms) transforms[at] = in.transform(list[k]);
+                        if (ids) ids[at] = in.id[list[k]];
+                    }
+                }
+            });
+
+            counters.tested = count;
+            counters.visible = total;
+            counters.written = written;
+            return written;
+        }
+
+        // last cull
+        batch_cull_stats stats() const {
+            return counters;
+        }
+    };
+
+};
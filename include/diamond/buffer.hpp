@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "opengl.hpp"
+#include "enums.hpp"
 #include <vector>
 #include <tuple>
 #include <utility>
@@ -10,11 +11,17 @@ namespace NS_NAME {
     class buffer_builder {
     public:
         static void create(GLuint * heap){
-            glCreateBuffers(1, heap);
+            if (!take_pooled_name<buffer_builder>(heap)) glCreateBuffers(1, heap);
+        }
+        static void create_n(GLsizei n, GLuint * heap, GLenum = 0){
+            glCreateBuffers(n, heap);
         }
         static void release(GLuint * heap){
             glDeleteBuffers(1, heap);
         }
+        static void release_n(GLsizei n, const GLuint * heap){
+            glDeleteBuffers(n, heap);
+        }
     };
 
     template<class T>
@@ -42,7 +49,7 @@ namespace NS_NAME {
             for (intptr_t pt = 0; pt < n; pt++) {
                 buffers.push_back(buffer(objects + pt));
             }
-            delete objects; // free, because pointer values was copied
+            delete[] objects; // free, because pointer values was copied
             return std::move(buffers);
         }
 
@@ -58,12 +65,32 @@ namespace NS_NAME {
             glNamedBufferSubData(thisref, offset, size, data);
         }
 
-        void storage(GLsizei size, const void *data = nullptr, buffer_storage_bits flags = GL_DYNAMIC_STORAGE_BIT) {
+        // size is GLsizeiptr, buffers may exceed 2 GiB
+        void storage(GLsizeiptr size, const void *data = nullptr, buffer_storage_bits flags = GL_DYNAMIC_STORAGE_BIT) {
             glNamedBufferStorage(thisref, size, data, flags.bitfield);
         }
 
         void copydata(void_buffer<T>& dest, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size){
-            glCopyNamedBufferSubData(thisref, *dest, readOffset, writeOffset, size);
+            glCopyNamedBufferSubData(thisref, dest, readOffset, writeOffset, size);
+        }
+
+        // map range (GL_MAP_* access bits), persistent maps stay valid across draws
+        void * map_range(GLintptr offset, GLsizeiptr length, GLbitfield access) {
+            return glMapNamedBufferRange(thisref, offset, length, access);
+        }
+
+        GLboolean unmap() {
+            return glUnmapNamedBuffer(thisref);
+        }
+
+        // explicit flush (GL_MAP_FLUSH_EXPLICIT_BIT), offset relative to mapped range
+        void flush_range(GLintptr offset, GLsizeiptr length) {
+            glFlushMappedNamedBufferRange(thisref, offset, length);
+        }
+
+        // zero range (offset and size multiple of 4)
+        void clear_subdata(GLintptr offset, GLsizeiptr size) {
+            glClearNamedBufferSubData(thisref, GL_R32UI, offset, size, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
         }
 
 
@@ -163,6 +190,9 @@ namespace NS_NAME {
         _buffer_context array(GL_ARRAY_BUFFER);
         _buffer_context shader_storage(GL_SHADER_STORAGE_BUFFER);
         _buffer_context uniform(GL_UNIFORM_BUFFER);
+        _buffer_context draw_indirect(GL_DRAW_INDIRECT_BUFFER);
+        _buffer_context dispatch_indirect(GL_DISPATCH_INDIRECT_BUFFER);
+        _buffer_context parameter(GL_PARAMETER_BUFFER);
     }
 
 };
\ No newline at end of file
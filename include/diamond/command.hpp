@@ -1,9 +1,35 @@
 #pragma once
 
 #include "opengl.hpp"
+#include "enums.hpp"
+#include "buffer.hpp"
+#include "query.hpp"
 
 namespace NS_NAME {
 
+    // indirect command layouts
+    struct dispatch_indirect_command {
+        GLuint num_groups_x = 0;
+        GLuint num_groups_y = 1;
+        GLuint num_groups_z = 1;
+    };
+
+    struct draw_arrays_indirect_command {
+        GLuint count = 0;
+        GLuint instance_count = 1;
+        GLuint first = 0;
+        GLuint base_instance = 0;
+    };
+
+    struct draw_elements_indirect_command {
+        GLuint count = 0;
+        GLuint instance_count = 1;
+        GLuint first_index = 0;
+        GLint base_vertex = 0;
+        GLuint base_instance = 0;
+    };
+
+
     class _dispatch {
     public:
         void compute(GLuint enq) {
@@ -21,6 +47,12 @@ namespace NS_NAME {
         void compute_indirect(GLintptr indirect = 0) {
             glDispatchComputeIndirect(indirect);
         }
+
+        // binds dispatch indirect buffer, offset of dispatch_indirect_command in bytes
+        void compute_indirect(buffer& args, GLintptr indirect = 0) {
+            glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, args);
+            glDispatchComputeIndirect(indirect);
+        }
     };
 
     class _mode {
@@ -42,6 +74,15 @@ namespace NS_NAME {
             glDrawElementsBaseVertex(thisref, count, type, indices, basevertex);
         }
 
+        // base instance offsets instanced attributes and gl_BaseInstance (per draw data index)
+        void arrays_base_instance(GLint first, GLsizei count = 1, GLsizei primcount = 1, GLuint baseinstance = 0) {
+            glDrawArraysInstancedBaseInstance(thisref, first, count, primcount, baseinstance);
+        }
+
+        void elements_base_instance(GLsizei count = 1, GLenum type = GL_UNSIGNED_INT, const GLvoid * indices = nullptr, GLsizei primcount = 1, GLint basevertex = 0, GLuint baseinstance = 0) {
+            glDrawElementsInstancedBaseVertexBaseInstance(thisref, count, type, indices, primcount, basevertex, baseinstance);
+        }
+
         void elements_range(glm::ivec2 range, GLsizei count = 1, GLenum type = GL_UNSIGNED_INT, const GLvoid * indices = nullptr, GLsizei primcount = 1) {
             glDrawRangeElements(thisref, range.x, range.y, count, type, indices);
         }
@@ -54,6 +95,16 @@ namespace NS_NAME {
             glDrawElementsIndirect(thisref, type, indirect);
         }
 
+        // drawcount commands from bound draw indirect buffer
+        void multi_elements_indirect(GLenum type = GL_UNSIGNED_INT, const void *indirect = 0, GLsizei drawcount = 1, GLsizei stride = 0) {
+            glMultiDrawElementsIndirect(thisref, type, indirect, drawcount, stride);
+        }
+
+        // draw count read from bound parameter buffer (at drawcount offset)
+        void elements_indirect_count(GLenum type = GL_UNSIGNED_INT, const void *indirect = 0, GLintptr drawcount = 0, GLsizei maxdrawcount = 1, GLsizei stride = 0) {
+            glMultiDrawElementsIndirectCount(thisref, type, indirect, drawcount, maxdrawcount, stride);
+        }
+
         operator GLenum(){ return target; }
     };
 
@@ -73,6 +124,24 @@ namespace NS_NAME {
 
 
 
+    // ends conditional render at scope exit (no condition when query is null)
+    class conditional_render_scope {
+    protected:
+        bool active = false;
+
+    public:
+        conditional_render_scope(query * q, GLenum mode = GL_QUERY_NO_WAIT) : active(q != nullptr) {
+            if (active) glBeginConditionalRender(*q, mode);
+        }
+        conditional_render_scope(conditional_render_scope&& another) : active(another.active) { another.active = false; }
+        conditional_render_scope(const conditional_render_scope&) = delete;
+
+        ~conditional_render_scope() {
+            if (active) glEndConditionalRender();
+        }
+    };
+
+
     class _commands {
     public:
         void draw_arrays(_mode& mode, GLint first, GLsizei count = 1, GLsizei primcount = 1) {
@@ -87,6 +156,14 @@ namespace NS_NAME {
             mode.elements_base_vertex(count, type, indices, basevertex);
         }
 
+        void draw_arrays_base_instance(_mode& mode, GLint first, GLsizei count = 1, GLsizei primcount = 1, GLuint baseinstance = 0) {
+            mode.arrays_base_instance(first, count, primcount, baseinstance);
+        }
+
+        void draw_elements_base_instance(_mode& mode, GLsizei count = 1, GLenum type = GL_UNSIGNED_INT, const GLvoid * indices = nullptr, GLsizei primcount = 1, GLint basevertex = 0, GLuint baseinstance = 0) {
+            mode.elements_base_instance(count, type, indices, primcount, basevertex, baseinstance);
+        }
+
         void draw_elements_range(_mode& mode, glm::ivec2 range, GLsizei count = 1, GLenum type = GL_UNSIGNED_INT, const GLvoid * indices = nullptr, GLsizei primcount = 1) {
             mode.elements_range(range, count, type, indices, primcount);
         }
@@ -99,10 +176,41 @@ namespace NS_NAME {
             mode.elements_indirect(type, indirect);
         }
 
+        void multi_draw_elements_indirect(_mode& mode, GLenum type = GL_UNSIGNED_INT, const void *indirect = 0, GLsizei drawcount = 1, GLsizei stride = 0) {
+            mode.multi_elements_indirect(type, indirect, drawcount, stride);
+        }
+
+        void draw_elements_indirect_count(_mode& mode, GLenum type = GL_UNSIGNED_INT, const void *indirect = 0, GLintptr drawcount = 0, GLsizei maxdrawcount = 1, GLsizei stride = 0) {
+            mode.elements_indirect_count(type, indirect, drawcount, maxdrawcount, stride);
+        }
+
         // planned support of new clear bitfield
         void clear(attrib_bits cbits) {
             glClear(cbits.bitfield);
         }
+
+        // draws are discarded by GPU when query counted no samples
+        void begin_conditional_render(query& q, GLenum mode = GL_QUERY_NO_WAIT) {
+            glBeginConditionalRender(q, mode);
+        }
+
+        void end_conditional_render() {
+            glEndConditionalRender();
+        }
+
+        // scoped form, e.g. auto scope = commands.conditional_render(pool.latest(id));
+        conditional_render_scope conditional_render(query * q, GLenum mode = GL_QUERY_NO_WAIT) {
+            return conditional_render_scope(q, mode);
+        }
+
+        // order incoherent (image, SSBO, atomic) writes before listed accesses
+        void memory_barrier(memory_barrier_bits bits) {
+            if (bits.bitfield) glMemoryBarrier(bits.bitfield);
+        }
+
+        void memory_barrier_by_region(memory_barrier_bits bits) {
+            if (bits.bitfield) glMemoryBarrierByRegion(bits.bitfield);
+        }
     };
 
 
@@ -0,0 +1,495 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "enums.hpp"
+#include "texture.hpp"
+#include "parallel.hpp"
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+namespace NS_NAME {
+
+    // encoder quality preset
+    struct bc_preset {
+        bool principal_axis = true; // PCA endpoints, otherwise bounding box
+        int refine_iterations = 1; // least squares endpoint refinements
+        size_t rows_per_job = 4; // block rows per pool job
+    };
+
+    namespace compression_preset {
+        bc_preset fast{ false, 0, 8 };
+        bc_preset normal{ true, 1, 4 };
+        bc_preset high{ true, 4, 2 };
+    };
+
+
+    // measured throughput of last encode
+    struct encode_stats {
+        size_t pixels = 0;
+        size_t threads = 1;
+        double seconds = 0.0;
+
+        double mpix_per_second() const {
+            return seconds > 0.0 ? double(pixels) / seconds * 1e-6 : 0.0;
+        }
+
+        double mpix_per_second_core() const {
+            return mpix_per_second() / double(std::max(threads, size_t(1)));
+        }
+    };
+
+
+    // 4x4 block kernels, RGBA8 input
+    namespace bc_detail {
+
+        struct block {
+            glm::vec4 px[16];
+        };
+
+        // least significant bit first writer for 128-bit blocks
+        struct bit_writer {
+            uint8_t * out;
+            uint32_t pos = 0;
+
+            bit_writer(uint8_t * out, size_t bytes) : out(out) {
+                std::memset(out, 0, bytes);
+            }
+
+            void put(uint32_t value, uint32_t bits) {
+                for (uint32_t i = 0; i < bits; i++, pos++) {
+                    if ((value >> i) & 1u) out[pos >> 3] |= uint8_t(1u << (pos & 7));
+                }
+            }
+        };
+
+        inline float distance2(const glm::vec4& a, const glm::vec4& b, const glm::vec4& mask) {
+            glm::vec4 d = (a - b) * mask;
+            return glm::dot(d, d);
+        }
+
+        // endpoints along the principal axis (or the box diagonal) of masked channels
+        inline void fit_endpoints(const glm::vec4 * px, int n, const glm::vec4& mask, bool principal, glm::vec4& e0, glm::vec4& e1) {
+            glm::vec4 mn(255.f), mx(0.f), mean(0.f);
+            for (int i = 0; i < n; i++) {
+                mn = glm::min(mn, px[i] * mask);
+                mx = glm::max(mx, px[i] * mask);
+                mean += px[i] * mask;
+            }
+            mean /= float(std::max(n, 1));
+
+            if (principal && n > 1) {
+                glm::mat4 cov(0.f);
+                for (int i = 0; i < n; i++) {
+                    glm::vec4 d = px[i] * mask - mean;
+                    cov += glm::outerProduct(d, d);
+                }
+                glm::vec4 axis = mx - mn;
+                for (int it = 0; it < 8; it++) {
+                    glm::vec4 next = cov * axis;
+                    float len = glm::length(next);
+                    if (len < 1e-6f) break;
+                    axis = next / len;
+                }
+                float len = glm::length(axis);
+                if (len > 1e-6f) {
+                    axis /= len;
+                    float tmin = 1e30f, tmax = -1e30f;
+                    for (int i = 0; i < n; i++) {
+                        float t = glm::dot(px[i] * mask - mean, axis);
+                        tmin = std::min(tmin, t);
+                        tmax = std::max(tmax, t);
+                    }
+                    mn = glm::clamp(mean + axis * tmin, 0.f, 255.f);
+                    mx = glm::clamp(mean + axis * tmax, 0.f, 255.f);
+                }
+            }
+
+            // inset by 1/16 of range, reduces error of interpolated entries
+            glm::vec4 inset = (mx - mn) / 16.f;
+            e0 = glm::clamp(mx - inset, 0.f, 255.f);
+            e1 = glm::clamp(mn + inset, 0.f, 255.f);
+        }
+
+        // solve endpoints for weights (w is weight of e1)
+        inline bool least_squares(const glm::vec4 * px, const float * w, int n, glm::vec4& e0, glm::vec4& e1) {
+            float aa = 0.f, bb = 0.f, ab = 0.f;
+            glm::vec4 ax(0.f), bx(0.f);
+            for (int i = 0; i < n; i++) {
+                if (w[i] < 0.f) continue;
+                float a = 1.f - w[i], b = w[i];
+                aa += a * a; bb += b * b; ab += a * b;
+                ax += a * px[i]; bx += b * px[i];
+            }
+            float det = aa * bb - ab * ab;
+            if (std::abs(det) < 1e-6f) return false;
+            e0 = glm::clamp((bb * ax - ab * bx) / det, 0.f, 255.f);
+            e1 = glm::clamp((aa * bx - ab * ax) / det, 0.f, 255.f);
+            return true;
+        }
+
+
+        // BC1 color
+        inline uint16_t pack565(const glm::vec4& c) {
+            uint32_t r = uint32_t(c.r * 31.f / 255.f + 0.5f);
+            uint32_t g = uint32_t(c.g * 63.f / 255.f + 0.5f);
+            uint32_t b = uint32_t(c.b * 31.f / 255.f + 0.5f);
+            return uint16_t((r << 11) | (g << 5) | b);
+        }
+
+        inline glm::vec4 unpack565(uint16_t v) {
+            uint32_t r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+            return glm::vec4(float((r << 3) | (r >> 2)), float((g << 2) | (g >> 4)), float((b << 3) | (b >> 2)), 255.f);
+        }
+
+        inline void bc1_palette(uint16_t c0, uint16_t c1, bool four, glm::vec4 * pal) {
+            pal[0] = unpack565(c0);
+            pal[1] = unpack565(c1);
+            if (four) {
+                pal[2] = (2.f * pal[0] + pal[1]) / 3.f;
+                pal[3] = (pal[0] + 2.f * pal[1]) / 3.f;
+            } else {
+                pal[2] = (pal[0] + pal[1]) * 0.5f;
+                pal[3] = glm::vec4(0.f);
+            }
+        }
+
+        // returns squared error, indices written to idx
+        inline float bc1_indices(const block& b, uint16_t c0, uint16_t c1, bool four, const bool * transparent, uint32_t& idx) {
+            const glm::vec4 rgb(1.f, 1.f, 1.f, 0.f);
+            glm::vec4 pal[4];
+            bc1_palette(c0, c1, four, pal);
+            float error = 0.f;
+            idx = 0;
+            for (int i = 0; i < 16; i++) {
+                uint32_t best = 0;
+                if (transparent && transparent[i]) {
+                    best = 3;
+                } else {
+                    float bestd = 1e30f;
+                    for (uint32_t k = 0; k < (four ? 4u : 3u); k++) {
+                        float d = distance2(b.px[i], pal[k], rgb);
+                        if (d < bestd) { bestd = d; best = k; }
+                    }
+                    error += bestd;
+                }
+                idx |= best << (2 * i);
+            }
+            return error;
+        }
+
+        inline void encode_bc1(const block& b, bool punchthrough, bool force_four, const bc_preset& preset, uint8_t * out) {
+            const glm::vec4 rgb(1.f, 1.f, 1.f, 0.f);
+            bool transparent[16];
+            glm::vec4 opaque[16];
+            int n = 0;
+            for (int i = 0; i < 16; i++) {
+                transparent[i] = punchthrough && b.px[i].a < 128.f;
+                if (!transparent[i]) opaque[n++] = b.px[i];
+            }
+            const bool three = n < 16 && !force_four;
+
+            glm::vec4 e0(0.f), e1(0.f);
+            if (n > 0) fit_endpoints(opaque, n, rgb, preset.principal_axis, e0, e1);
+
+            uint16_t c0 = pack565(e0), c1 = pack565(e1);
+            auto order = [&](uint16_t& a, uint16_t& z) {
+                if (three ? a > z : a < z) std::swap(a, z); // three color mode needs c0 <= c1
+            };
+            order(c0, c1);
+
+            uint32_t idx = 0;
+            bool four = c0 > c1;
+            float error = bc1_indices(b, c0, c1, four, three ? transparent : nullptr, idx);
+
+            for (int it = 0; it < preset.refine_iterations && error > 0.f; it++) {
+                static const float w4[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+                static const float w3[4] = { 0.f, 1.f, 0.5f, -1.f };
+                float w[16];
+                for (int i = 0; i < 16; i++) w[i] = (four ? w4 : w3)[(idx >> (2 * i)) & 3];
+                glm::vec4 r0 = e0, r1 = e1;
+                if (!least_squares(b.px, w, 16, r0, r1)) break;
+                uint16_t n0 = pack565(r0), n1 = pack565(r1);
+                order(n0, n1);
+                uint32_t nidx = 0;
+                bool nfour = n0 > n1;
+                float nerror = bc1_indices(b, n0, n1, nfour, three ? transparent : nullptr, nidx);
+                if (nerror >= error) break;
+                error = nerror; idx = nidx; c0 = n0; c1 = n1; e0 = r0; e1 = r1; four = nfour;
+            }
+
+            // BC3 color blocks always decode in four color mode
+            if (force_four && !four) idx = 0;
+
+            std::memcpy(out + 0, &c0, 2);
+            std::memcpy(out + 2, &c1, 2);
+            std::memcpy(out + 4, &idx, 4);
+        }
+
+
+        // BC4 single channel (also alpha of BC3 and both halves of BC5)
+        inline float bc4_indices(const float * v, float a0, float a1, uint64_t& idx) {
+            float pal[8] = { a0, a1 };
+            for (int k = 1; k < 7; k++) pal[k + 1] = ((7 - k) * a0 + k * a1) / 7.f;
+            float error = 0.f;
+            idx = 0;
+            for (int i = 0; i < 16; i++) {
+                uint64_t best = 0;
+                float bestd = 1e30f;
+                for (uint64_t k = 0; k < 8; k++) {
+                    float d = (v[i] - pal[k]) * (v[i] - pal[k]);
+                    if (d < bestd) { bestd = d; best = k; }
+                }
+                error += bestd;
+                idx |= best << (3 * i);
+            }
+            return error;
+        }
+
+        inline void encode_bc4(const float * v, const bc_preset& preset, uint8_t * out) {
+            float mn = 255.f, mx = 0.f;
+            for (int i = 0; i < 16; i++) { mn = std::min(mn, v[i]); mx = std::max(mx, v[i]); }
+
+            uint8_t a0 = uint8_t(mx + 0.5f), a1 = uint8_t(mn + 0.5f);
+            uint64_t idx = 0;
+            float error = 0.f;
+            if (a0 == a1) {
+                idx = 0; // single value block (six value mode, all index zero)
+            } else {
+                error = bc4_indices(v, a0, a1, idx);
+                for (int it = 0; it < preset.refine_iterations && error > 0.f; it++) {
+                    static const float w8[8] = { 0.f, 1.f, 1.f / 7.f, 2.f / 7.f, 3.f / 7.f, 4.f / 7.f, 5.f / 7.f, 6.f / 7.f };
+                    glm::vec4 px[16];
+                    float w[16];
+                    for (int i = 0; i < 16; i++) { px[i] = glm::vec4(v[i]); w[i] = w8[(idx >> (3 * i)) & 7]; }
+                    glm::vec4 r0, r1;
+                    if (!least_squares(px, w, 16, r0, r1)) break;
+                    uint8_t n0 = uint8_t(r0.x + 0.5f), n1 = uint8_t(r1.x + 0.5f);
+                    if (n0 <= n1) break;
+                    uint64_t nidx = 0;
+                    float nerror = bc4_indices(v, n0, n1, nidx);
+                    if (nerror >= error) break;
+                    error = nerror; idx = nidx; a0 = n0; a1 = n1;
+                }
+            }
+
+            out[0] = a0;
+            out[1] = a1;
+            for (int i = 0; i < 6; i++) out[2 + i] = uint8_t(idx >> (8 * i));
+        }
+
+        inline void encode_bc4_channel(const block& b, int channel, const bc_preset& preset, uint8_t * out) {
+            float v[16];
+            for (int i = 0; i < 16; i++) v[i] = b.px[i][channel];
+            encode_bc4(v, preset, out);
+        }
+
+
+        // BC7 mode 6 (single subset, RGBA 7.7.7.7 with unique p-bits, 4-bit indices)
+        inline glm::vec4 bc7_quantize(const glm::vec4& e, uint32_t& q, uint32_t& p) {
+            glm::vec4 best(0.f);
+            float bestd = 1e30f;
+            for (uint32_t pb = 0; pb < 2; pb++) {
+                glm::vec4 dec;
+                uint32_t packed = 0;
+                for (int c = 0; c < 4; c++) {
+                    uint32_t v = uint32_t(glm::clamp((e[c] - float(pb)) * 0.5f + 0.5f, 0.f, 127.f));
+                    packed |= v << (7 * c);
+                    dec[c] = float((v << 1) | pb);
+                }
+                float d = distance2(dec, e, glm::vec4(1.f));
+                if (d < bestd) { bestd = d; best = dec; q = packed; p = pb; }
+            }
+            return best;
+        }
+
+        inline float bc7_indices(const block& b, const glm::vec4& d0, const glm::vec4& d1, uint8_t * idx) {
+            static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+            glm::vec4 pal[16];
+            for (int k = 0; k < 16; k++) {
+                pal[k] = glm::floor((float(64 - weights[k]) * d0 + float(weights[k]) * d1 + 32.f) / 64.f);
+            }
+            float error = 0.f;
+            for (int i = 0; i < 16; i++) {
+                float bestd = 1e30f;
+                for (int k = 0; k < 16; k++) {
+                    float d = distance2(b.px[i], pal[k], glm::vec4(1.f));
+                    if (d < bestd) { bestd = d; idx[i] = uint8_t(k); }
+                }
+                error += bestd;
+            }
+            return error;
+        }
+
+        inline void encode_bc7(const block& b, const bc_preset& preset, uint8_t * out) {
+            glm::vec4 e0, e1;
+            fit_endpoints(b.px, 16, glm::vec4(1.f), preset.principal_axis, e0, e1);
+
+            uint32_t q0 = 0, q1 = 0, p0 = 0, p1 = 0;
+            glm::vec4 d0 = bc7_quantize(e0, q0, p0), d1 = bc7_quantize(e1, q1, p1);
+            uint8_t idx[16];
+            float error = bc7_indices(b, d0, d1, idx);
+
+            for (int it = 0; it < preset.refine_iterations && error > 0.f; it++) {
+                static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+                float w[16];
+                for (int i = 0; i < 16; i++) w[i] = float(weights[idx[i]]) / 64.f;
+                glm::vec4 r0, r1;
+                if (!least_squares(b.px, w, 16, r0, r1)) break;
+                uint32_t nq0 = 0, nq1 = 0, np0 = 0, np1 = 0;
+                glm::vec4 nd0 = bc7_quantize(r0, nq0, np0), nd1 = bc7_quantize(r1, nq1, np1);
+                uint8_t nidx[16];
+                float nerror = bc7_indices(b, nd0, nd1, nidx);
+                if (nerror >= error) break;
+                error = nerror; q0 = nq0; q1 = nq1; p0 = np0; p1 = np1;
+                std::memcpy(idx, nidx, 16);
+            }
+
+            // anchor index must have zero high bit
+            if (idx[0] & 8) {
+                std::swap(q0, q1);
+                std::swap(p0, p1);
+                for (int i = 0; i < 16; i++) idx[i] = uint8_t(15 - idx[i]);
+            }
+
+            bit_writer bw(out, 16);
+            bw.put(1u << 6, 7);
+            for (int c = 0; c < 4; c++) {
+                bw.put((q0 >> (7 * c)) & 127, 7);
+                bw.put((q1 >> (7 * c)) & 127, 7);
+            }
+            bw.put(p0, 1);
+            bw.put(p1, 1);
+            bw.put(idx[0], 3);
+            for (int i = 1; i < 16; i++) bw.put(idx[i], 4);
+        }
+
+    };
+
+
+    // CPU block compression encoder (BC1, BC3, BC4, BC5, BC7) for RGBA8 images
+    class block_encoder {
+    protected:
+        _internal_format format;
+        bc_preset preset;
+        thread_pool * pool;
+
+        void encode_block(const bc_detail::block& b, uint8_t * out) const {
+            switch (format.internal()) {
+                case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+                    bc_detail::encode_bc1(b, false, false, preset, out);
+                    break;
+                case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+                    bc_detail::encode_bc1(b, true, false, preset, out);
+                    break;
+                case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+                    bc_detail::encode_bc4_channel(b, 3, preset, out);
+                    bc_detail::encode_bc1(b, false, true, preset, out + 8);
+                    break;
+                case GL_COMPRESSED_RED_RGTC1:
+                    bc_detail::encode_bc4_channel(b, 0, preset, out);
+                    break;
+                case GL_COMPRESSED_RG_RGTC2:
+                    bc_detail::encode_bc4_channel(b, 0, preset, out);
+                    bc_detail::encode_bc4_channel(b, 1, preset, out + 8);
+                    break;
+                case GL_COMPRESSED_RGBA_BPTC_UNORM:
+                case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+                    bc_detail::encode_bc7(b, preset, out);
+                    break;
+            }
+        }
+
+    public:
+        block_encoder(const _internal_format& format, const bc_preset& preset = compression_preset::normal, thread_pool& pool = default_pool()) : format(format), preset(preset), pool(&pool) {
+        }
+
+        // supported unsigned formats only (signed RGTC needs signed input)
+        bool supported() const {
+            switch (format.internal()) {
+                case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+                case GL_COMPRESSED_RED_RGTC1:
+                case GL_COMPRESSED_RG_RGTC2:
+                case GL_COMPRESSED_RGBA_BPTC_UNORM:
+                case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+                    return true;
+            }
+            return false;
+        }
+
+        // compressed size of image in bytes
+        size_t encoded_size(glm::uvec2 size) const {
+            return size_t((size.x + 3) / 4) * size_t((size.y + 3) / 4) * size_t(format.block_bytes());
+        }
+
+        // compress tightly packed RGBA8 image, edge blocks are clamp padded
+        // blocks are empty (and stats zero) when format is not supported()
+        encode_stats encode(const uint8_t * rgba, glm::uvec2 size, std::vector<uint8_t>& blocks) const {
+            if (!this->supported()) {
+                blocks.clear();
+                return encode_stats();
+            }
+            const auto start = std::chrono::high_resolution_clock::now();
+            const size_t bx = (size.x + 3) / 4, by = (size.y + 3) / 4;
+            const size_t bytes = size_t(format.block_bytes());
+            blocks.resize(bx * by * bytes);
+
+            uint8_t * out = blocks.data();
+            pool->parallel_for(0, by, preset.rows_per_job, [&](size_t row_begin, size_t row_end) {
+                bc_detail::block b;
+                for (size_t y = row_begin; y < row_end; y++) {
+                    for (size_t x = 0; x < bx; x++) {
+                        for (uint32_t i = 0; i < 16; i++) {
+                            size_t px = std::min(x * 4 + (i & 3), size_t(size.x - 1));
+                            size_t py = std::min(y * 4 + (i >> 2), size_t(size.y - 1));
+                            const uint8_t * src = rgba + (py * size.x + px) * 4;
+                            b.px[i] = glm::vec4(src[0], src[1], src[2], src[3]);
+                        }
+                        encode_block(b, out + (y * bx + x) * bytes);
+                    }
+                }
+            });
+
+            encode_stats stats;
+            stats.pixels = size_t(size.x) * size_t(size.y);
+            stats.threads = std::min(pool->size() + 1, (by + preset.rows_per_job - 1) / std::max(preset.rows_per_job, size_t(1)));
+            stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            return stats;
+        }
+
+        std::vector<uint8_t> encode(const uint8_t * rgba, glm::uvec2 size) const {
+            std::vector<uint8_t> blocks;
+            this->encode(rgba, size, blocks);
+            return blocks;
+        }
+
+        // compress and upload into texture level (texture must have compressed storage of same format)
+        encode_stats upload(texture_level level, glm::ivec2 offset, const uint8_t * rgba, glm::uvec2 size) const {
+            std::vector<uint8_t> blocks;
+            encode_stats stats = this->encode(rgba, size, blocks);
+            if (blocks.empty()) return stats;
+            level.compressed_subimage(offset, size, format.internal(), GLsizei(blocks.size()), blocks.data());
+            return stats;
+        }
+
+        // array layer (or cube face) upload
+        encode_stats upload(texture_level level, glm::ivec3 offset, const uint8_t * rgba, glm::uvec2 size) const {
+            std::vector<uint8_t> blocks;
+            encode_stats stats = this->encode(rgba, size, blocks);
+            if (blocks.empty()) return stats;
+            level.compressed_subimage(offset, glm::uvec3(size, 1), format.internal(), GLsizei(blocks.size()), blocks.data());
+            return stats;
+        }
+    };
+
+};
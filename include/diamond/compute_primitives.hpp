@@ -0,0 +1,484 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "buffer.hpp"
+#include "program.hpp"
+#include "command.hpp"
+#include "managment.hpp"
+#include <string>
+#include <map>
+#include <memory>
+#include <algorithm>
+
+namespace NS_NAME {
+
+    // element type of primitive (32-bit)
+    enum class element_type { uint32, int32, float32 };
+
+    // associative operator of scan and reduce
+    enum class reduce_op { sum, min, max };
+
+
+    namespace primitives_source {
+
+        // linear workgroup index, large grids are dispatched as 2D
+        const char * common = R"(
+layout(local_size_x = WG_SIZE) in;
+uint group_index() { return gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x; }
+)";
+
+        const char * scan_block = R"(
+layout(std430, binding = 0) readonly buffer InBuf { T in_data[]; };
+layout(std430, binding = 1) writeonly buffer OutBuf { T out_data[]; };
+layout(std430, binding = 2) writeonly buffer SumBuf { T sum_data[]; };
+uniform uint count;
+uniform uint in_offset;
+uniform uint out_offset;
+uniform uint sum_offset;
+uniform uint inclusive;
+uniform uint write_sums;
+uniform uint predicate;
+shared T temp[WG_SIZE];
+
+void main() {
+    uint group = group_index();
+    uint lid = gl_LocalInvocationID.x;
+    uint gid = group * WG_SIZE + lid;
+    if (group * WG_SIZE >= count) return;
+
+    T v = gid < count ? in_data[in_offset + gid] : IDENTITY;
+    if (predicate != 0u) v = (gid < count && v != T(0)) ? T(1) : T(0);
+    temp[lid] = v;
+    barrier();
+    for (uint o = 1u; o < WG_SIZE; o <<= 1u) {
+        T t = lid >= o ? temp[lid - o] : IDENTITY;
+        barrier();
+        temp[lid] = OP(temp[lid], t);
+        barrier();
+    }
+
+    if (gid < count) out_data[out_offset + gid] = inclusive != 0u ? temp[lid] : (lid > 0u ? temp[lid - 1u] : IDENTITY);
+    if (write_sums != 0u && lid == WG_SIZE - 1u) sum_data[sum_offset + group] = temp[lid];
+}
+)";
+
+        const char * scan_add = R"(
+layout(std430, binding = 1) buffer OutBuf { T out_data[]; };
+layout(std430, binding = 2) readonly buffer SumBuf { T sum_data[]; };
+uniform uint count;
+uniform uint out_offset;
+uniform uint sum_offset;
+
+void main() {
+    uint group = group_index();
+    uint gid = group * WG_SIZE + gl_LocalInvocationID.x;
+    if (gid >= count) return;
+    out_data[out_offset + gid] = OP(out_data[out_offset + gid], sum_data[sum_offset + group]);
+}
+)";
+
+        // each thread folds 4 elements, then tree reduction
+        const char * reduce = R"(
+layout(std430, binding = 0) readonly buffer InBuf { T in_data[]; };
+layout(std430, binding = 1) writeonly buffer OutBuf { T out_data[]; };
+uniform uint count;
+uniform uint in_offset;
+uniform uint out_offset;
+shared T temp[WG_SIZE];
+
+void main() {
+    uint group = group_index();
+    uint lid = gl_LocalInvocationID.x;
+    uint base = group * WG_SIZE * 4u;
+    if (base >= count) return;
+
+    T v = IDENTITY;
+    for (uint k = 0u; k < 4u; k++) {
+        uint i = base + k * WG_SIZE + lid;
+        if (i < count) v = OP(v, in_data[in_offset + i]);
+    }
+    temp[lid] = v;
+    barrier();
+    for (uint s = WG_SIZE / 2u; s > 0u; s >>= 1u) {
+        if (lid < s) temp[lid] = OP(temp[lid], temp[lid + s]);
+        barrier();
+    }
+    if (lid == 0u) out_data[out_offset + group] = temp[0];
+}
+)";
+
+        const char * compact = R"(
+layout(std430, binding = 0) readonly buffer InBuf { T in_data[]; };
+layout(std430, binding = 1) writeonly buffer OutBuf { T out_data[]; };
+layout(std430, binding = 2) readonly buffer PosBuf { uint positions[]; };
+layout(std430, binding = 3) readonly buffer FlagBuf { uint flags[]; };
+layout(std430, binding = 4) writeonly buffer CountBuf { uint count_data[]; };
+uniform uint count;
+uniform uint in_offset;
+uniform uint out_offset;
+uniform uint pos_offset;
+uniform uint flag_offset;
+uniform uint count_offset;
+
+void main() {
+    uint gid = group_index() * WG_SIZE + gl_LocalInvocationID.x;
+    if (gid >= count) return;
+    bool keep = flags[flag_offset + gid] != 0u;
+    uint pos = positions[pos_offset + gid];
+    if (keep) out_data[out_offset + pos] = in_data[in_offset + gid];
+    if (gid == count - 1u) count_data[count_offset] = pos + (keep ? 1u : 0u);
+}
+)";
+
+        // 4-bit digit counts per tile, digit major layout
+        const char * radix_histogram = R"(
+layout(std430, binding = 0) readonly buffer KeyBuf { uint keys[]; };
+layout(std430, binding = 1) writeonly buffer CountBuf { uint counts[]; };
+uniform uint count;
+uniform uint key_offset;
+uniform uint shift;
+uniform uint word;
+uniform uint num_tiles;
+uniform uint counts_offset;
+shared uint hist[16];
+
+void main() {
+    uint group = group_index();
+    uint lid = gl_LocalInvocationID.x;
+    uint gid = group * WG_SIZE + lid;
+    if (group >= num_tiles) return;
+
+    if (lid < 16u) hist[lid] = 0u;
+    barrier();
+    if (gid < count) atomicAdd(hist[(keys[(key_offset + gid) * KEY_WORDS + word] >> shift) & 15u], 1u);
+    barrier();
+    if (lid < 16u) counts[counts_offset + lid * num_tiles + group] = hist[lid];
+}
+)";
+
+        // stable local split by 4 bits, then scatter to scanned digit offsets
+        const char * radix_scatter = R"(
+layout(std430, binding = 0) readonly buffer KeyIn { uint keys_in[]; };
+layout(std430, binding = 1) writeonly buffer KeyOut { uint keys_out[]; };
+layout(std430, binding = 2) readonly buffer ValIn { uint vals_in[]; };
+layout(std430, binding = 3) writeonly buffer ValOut { uint vals_out[]; };
+layout(std430, binding = 4) readonly buffer OffsetBuf { uint offsets[]; };
+uniform uint count;
+uniform uint in_key_offset;
+uniform uint out_key_offset;
+uniform uint in_val_offset;
+uniform uint out_val_offset;
+uniform uint shift;
+uniform uint word;
+uniform uint num_tiles;
+uniform uint offsets_offset;
+uniform uint has_values;
+shared uint s_key[KEY_WORDS][WG_SIZE];
+shared uint s_val[WG_SIZE];
+shared uint s_valid[WG_SIZE];
+shared uint s_scan[WG_SIZE];
+shared uint s_hist[16];
+shared uint s_start[16];
+
+uint digit_of(uint lid) { return (s_key[word][lid] >> shift) & 15u; }
+
+void main() {
+    uint group = group_index();
+    uint lid = gl_LocalInvocationID.x;
+    uint gid = group * WG_SIZE + lid;
+    if (group >= num_tiles) return;
+
+    bool valid = gid < count;
+    for (uint w = 0u; w < KEY_WORDS; w++) s_key[w][lid] = valid ? keys_in[(in_key_offset + gid) * KEY_WORDS + w] : 0xFFFFFFFFu;
+    s_val[lid] = (valid && has_values != 0u) ? vals_in[in_val_offset + gid] : 0u;
+    s_valid[lid] = valid ? 1u : 0u;
+    if (lid < 16u) s_hist[lid] = 0u;
+    barrier();
+    if (valid) atomicAdd(s_hist[digit_of(lid)], 1u);
+
+    for (uint b = 0u; b < 4u; b++) {
+        uint key[KEY_WORDS];
+        for (uint w = 0u; w < KEY_WORDS; w++) key[w] = s_key[w][lid];
+        uint val = s_val[lid], vd = s_valid[lid];
+        uint bit = (digit_of(lid) >> b) & 1u;
+        barrier();
+        s_scan[lid] = bit;
+        barrier();
+        for (uint o = 1u; o < WG_SIZE; o <<= 1u) {
+            uint t = lid >= o ? s_scan[lid - o] : 0u;
+            barrier();
+            s_scan[lid] += t;
+            barrier();
+        }
+        uint ones_before = s_scan[lid] - bit;
+        uint zeros = WG_SIZE - s_scan[WG_SIZE - 1u];
+        uint pos = bit == 0u ? lid - ones_before : zeros + ones_before;
+        barrier();
+        for (uint w = 0u; w < KEY_WORDS; w++) s_key[w][pos] = key[w];
+        s_val[pos] = val;
+        s_valid[pos] = vd;
+        barrier();
+    }
+
+    if (lid == 0u) {
+        uint sum = 0u;
+        for (uint i = 0u; i < 16u; i++) { s_start[i] = sum; sum += s_hist[i]; }
+    }
+    barrier();
+
+    if (s_valid[lid] != 0u) {
+        uint d = digit_of(lid);
+        uint dst = offsets[offsets_offset + d * num_tiles + group] + (lid - s_start[d]);
+        for (uint w = 0u; w < KEY_WORDS; w++) keys_out[(out_key_offset + dst) * KEY_WORDS + w] = s_key[w][lid];
+        if (has_values != 0u) vals_out[out_val_offset + dst] = s_val[lid];
+    }
+}
+)";
+    };
+
+
+    // scan, reduce, stream compaction and radix sort over buffer ranges (offsets in elements)
+    class compute_primitives {
+    protected:
+        struct kernel {
+            program prog;
+            std::map<std::string, GLint> locations;
+
+            kernel(const std::string& source) : prog(GL_COMPUTE_SHADER, source) {}
+
+            kernel& set(const std::string& name, GLuint value) {
+                auto found = locations.find(name);
+                if (found == locations.end()) found = locations.emplace(name, glGetUniformLocation(prog, name.c_str())).first;
+                prog.get_uniform<GLuint>(GLuint(found->second)) = value;
+                return thisref;
+            }
+        };
+
+        GLuint wg_size = 256;
+        GLuint max_groups_x = 65535;
+        std::map<std::string, std::unique_ptr<kernel>> kernels;
+        std::unique_ptr<buffer> scratch;
+        GLsizeiptr scratch_bytes = 0;
+        std::string log;
+
+        static const char * type_name(element_type type) {
+            switch (type) {
+                case element_type::int32: return "int";
+                case element_type::float32: return "float";
+                default: return "uint";
+            }
+        }
+
+        static std::string identity(element_type type, reduce_op op) {
+            if (op == reduce_op::sum) return std::string(type_name(type)) + "(0)";
+            const bool low = op == reduce_op::max;
+            switch (type) {
+                case element_type::int32: return low ? "(-2147483647 - 1)" : "2147483647";
+                case element_type::float32: return low ? "(-3.402823466e+38)" : "3.402823466e+38";
+                default: return low ? "0u" : "0xFFFFFFFFu";
+            }
+        }
+
+        kernel& get(const std::string& name, const char * body, element_type type = element_type::uint32, reduce_op op = reduce_op::sum, GLuint key_words = 1) {
+            const std::string key = name + "/" + type_name(type) + "/" + std::to_string(int(op)) + "/" + std::to_string(key_words);
+            auto found = kernels.find(key);
+            if (found != kernels.end()) return *found->second;
+
+            std::string source = "#version 460 core\n";
+            source += "#define WG_SIZE " + std::to_string(wg_size) + "u\n";
+            source += "#define KEY_WORDS " + std::to_string(key_words) + "u\n";
+            source += std::string("#define T ") + type_name(type) + "\n";
+            source += "#define IDENTITY " + identity(type, op) + "\n";
+            source += op == reduce_op::sum ? "#define OP(a, b) ((a) + (b))\n" : op == reduce_op::min ? "#define OP(a, b) min(a, b)\n" : "#define OP(a, b) max(a, b)\n";
+            source += primitives_source::common;
+            source += body;
+
+            auto k = std::make_unique<kernel>(source);
+            if (!k->prog.get_val<int>(GL_LINK_STATUS)) log += name + ": " + k->prog.info_log() + "\n";
+            return *kernels.emplace(key, std::move(k)).first->second;
+        }
+
+        void bind(GLuint index, buffer& buf) {
+            buffer_binding(buffer_target::shader_storage, index).bind(buf);
+        }
+
+        void launch(kernel& k, GLuint groups) {
+            managment.use_program(k.prog);
+            if (groups <= max_groups_x) dispatch.compute(glm::uvec3(groups, 1, 1));
+            else dispatch.compute(glm::uvec3(max_groups_x, (groups + max_groups_x - 1) / max_groups_x, 1));
+            commands.memory_barrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+
+        GLuint groups_of(GLuint count, GLuint per_group) const {
+            return (count + per_group - 1) / per_group;
+        }
+
+        // elements of block sum levels for scan of count
+        GLuint scan_scratch(GLuint count) const {
+            GLuint total = 0;
+            for (GLuint n = groups_of(count, wg_size); n > 1; n = groups_of(n, wg_size)) total += n;
+            return total + 1;
+        }
+
+        // scratch is replaced when growing, callers reserve before using regions
+        buffer& reserve(GLsizeiptr bytes) {
+            if (!scratch || bytes > scratch_bytes) {
+                scratch_bytes = std::max(bytes, scratch_bytes * 2);
+                scratch = std::make_unique<buffer>();
+                scratch->storage(GLsizeiptr(scratch_bytes), nullptr, 0);
+            }
+            return *scratch;
+        }
+
+        void scan_impl(buffer& in, GLuint in_offset, buffer& out, GLuint out_offset, GLuint count, bool inclusive, bool predicate, element_type type, reduce_op op, GLuint scratch_base) {
+            const GLuint groups = groups_of(count, wg_size);
+            kernel& block = get("scan_block", primitives_source::scan_block, type, op);
+            bind(0, in);
+            bind(1, out);
+            bind(2, *scratch);
+            block.set("count", count).set("in_offset", in_offset).set("out_offset", out_offset).set("sum_offset", scratch_base);
+            block.set("inclusive", inclusive ? 1 : 0).set("write_sums", groups > 1 ? 1 : 0).set("predicate", predicate ? 1 : 0);
+            launch(block, groups);
+            if (groups <= 1) return;
+
+            // exclusive prefix of block totals, then add to blocks
+            scan_impl(*scratch, scratch_base, *scratch, scratch_base, groups, false, false, type, op, scratch_base + groups);
+            kernel& add = get("scan_add", primitives_source::scan_add, type, op);
+            bind(1, out);
+            bind(2, *scratch);
+            add.set("count", count).set("out_offset", out_offset).set("sum_offset", scratch_base);
+            launch(add, groups);
+        }
+
+    public:
+        // workgroup size is clamped by queried compute limits
+        compute_primitives(GLuint preferred_size = 256) {
+            GLint invocations = 0, size_x = 0, groups_x = 0, shared_bytes = 0;
+            glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &invocations);
+            glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &size_x);
+            glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &groups_x);
+            glGetIntegerv(GL_MAX_COMPUTE_SHARED_MEMORY_SIZE, &shared_bytes);
+
+            // radix scatter keeps 5 words per invocation (64-bit keys) in shared memory
+            GLuint limit = std::min(GLuint(std::max(invocations, 64)), GLuint(std::max(size_x, 64)));
+            limit = std::min(limit, GLuint(std::max(shared_bytes, 16384) - 256) / 20u);
+            wg_size = 64;
+            while (wg_size * 2 <= std::min(limit, preferred_size)) wg_size *= 2;
+            max_groups_x = GLuint(std::max(groups_x, 1));
+        }
+
+        GLuint workgroup_size() const {
+            return wg_size;
+        }
+
+        std::string info_log() const {
+            return log;
+        }
+
+        // out[i] = in[0] op .. op in[i - 1]
+        void exclusive_scan(buffer& in, GLuint in_offset, buffer& out, GLuint out_offset, GLuint count, element_type type = element_type::uint32, reduce_op op = reduce_op::sum) {
+            if (!count) return;
+            reserve(GLsizeiptr(scan_scratch(count)) * 4);
+            scan_impl(in, in_offset, out, out_offset, count, false, false, type, op, 0);
+        }
+
+        // out[i] = in[0] op .. op in[i]
+        void inclusive_scan(buffer& in, GLuint in_offset, buffer& out, GLuint out_offset, GLuint count, element_type type = element_type::uint32, reduce_op op = reduce_op::sum) {
+            if (!count) return;
+            reserve(GLsizeiptr(scan_scratch(count)) * 4);
+            scan_impl(in, in_offset, out, out_offset, count, true, false, type, op, 0);
+        }
+
+        // single value written to result[result_offset]
+        void reduce(buffer& in, GLuint in_offset, GLuint count, buffer& result, GLuint result_offset, element_type type = element_type::uint32, reduce_op op = reduce_op::sum) {
+            if (!count) return;
+            const GLuint per_group = wg_size * 4;
+            const GLuint first = groups_of(count, per_group);
+            reserve(GLsizeiptr(first + groups_of(first, per_group) + 1) * 4);
+
+            kernel& k = get("reduce", primitives_source::reduce, type, op);
+            buffer * src = &in;
+            GLuint src_offset = in_offset, n = count, ping = 0;
+            for (;;) {
+                const GLuint groups = groups_of(n, per_group);
+                const bool last = groups == 1;
+                const GLuint dst_offset = ping ? first : 0; // two scratch regions
+                bind(0, *src);
+                bind(1, last ? result : *scratch);
+                k.set("count", n).set("in_offset", src_offset).set("out_offset", last ? result_offset : dst_offset);
+                launch(k, groups);
+                if (last) break;
+                src = scratch.get();
+                src_offset = dst_offset;
+                n = groups;
+                ping ^= 1;
+            }
+        }
+
+        // keep in[i] where flags[i] != 0, order preserved; kept count to counter[counter_offset]
+        void compact(buffer& in, GLuint in_offset, buffer& flags, GLuint flags_offset, GLuint count, buffer& out, GLuint out_offset, buffer& counter, GLuint counter_offset, element_type type = element_type::uint32) {
+            if (!count) return;
+            reserve(GLsizeiptr(count + scan_scratch(count)) * 4);
+            scan_impl(flags, flags_offset, *scratch, 0, count, false, true, element_type::uint32, reduce_op::sum, count);
+
+            kernel& k = get("compact", primitives_source::compact, type);
+            bind(0, in);
+            bind(1, out);
+            bind(2, *scratch);
+            bind(3, flags);
+            bind(4, counter);
+            k.set("count", count).set("in_offset", in_offset).set("out_offset", out_offset).set("pos_offset", 0);
+            k.set("flag_offset", flags_offset).set("count_offset", counter_offset);
+            launch(k, groups_of(count, wg_size));
+        }
+
+        // LSD radix sort of 32 or 64-bit (two uint words, low first) keys with optional uint values
+        void sort(buffer& keys, GLuint key_offset, GLuint count, buffer * values = nullptr, GLuint value_offset = 0, GLuint key_bits = 32) {
+            if (count < 2) return;
+            const GLuint words = key_bits > 32 ? 2 : 1;
+            const GLuint tiles = groups_of(count, wg_size);
+            const GLuint counts = tiles * 16;
+
+            // scratch: keys, values, digit counts, scan levels
+            const GLuint tmp_keys = 0, tmp_vals = count * words, counts_base = tmp_vals + count;
+            reserve(GLsizeiptr(counts_base + counts + scan_scratch(counts)) * 4);
+
+            kernel& hist = get("radix_histogram", primitives_source::radix_histogram, element_type::uint32, reduce_op::sum, words);
+            kernel& scatter = get("radix_scatter", primitives_source::radix_scatter, element_type::uint32, reduce_op::sum, words);
+            buffer& vals = values ? *values : keys;
+
+            const GLuint passes = words * 8; // even, result lands in source buffer
+            for (GLuint pass = 0; pass < passes; pass++) {
+                const bool forward = (pass & 1) == 0;
+                buffer& key_src = forward ? keys : *scratch;
+                buffer& key_dst = forward ? *scratch : keys;
+                buffer& val_src = forward ? vals : *scratch;
+                buffer& val_dst = forward ? *scratch : vals;
+                const GLuint key_src_offset = forward ? key_offset : tmp_keys / words;
+                const GLuint key_dst_offset = forward ? tmp_keys / words : key_offset;
+                const GLuint val_src_offset = forward ? value_offset : tmp_vals;
+                const GLuint val_dst_offset = forward ? tmp_vals : value_offset;
+                const GLuint shift = (pass % 8) * 4, word = pass / 8;
+
+                bind(0, key_src);
+                bind(1, *scratch);
+                hist.set("count", count).set("key_offset", key_src_offset).set("shift", shift).set("word", word);
+                hist.set("num_tiles", tiles).set("counts_offset", counts_base);
+                launch(hist, tiles);
+
+                scan_impl(*scratch, counts_base, *scratch, counts_base, counts, false, false, element_type::uint32, reduce_op::sum, counts_base + counts);
+
+                bind(0, key_src);
+                bind(1, key_dst);
+                bind(2, val_src);
+                bind(3, val_dst);
+                bind(4, *scratch);
+                scatter.set("count", count).set("in_key_offset", key_src_offset).set("out_key_offset", key_dst_offset);
+                scatter.set("in_val_offset", val_src_offset).set("out_val_offset", val_dst_offset).set("shift", shift).set("word", word);
+                scatter.set("num_tiles", tiles).set("offsets_offset", counts_base).set("has_values", values ? 1 : 0);
+                launch(scatter, tiles);
+            }
+        }
+    };
+
+};
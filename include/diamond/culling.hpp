@@ -0,0 +1,226 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "buffer.hpp"
+#include "texture.hpp"
+#include "program.hpp"
+#include "command.hpp"
+#include "managment.hpp"
+#include "downsampler.hpp"
+#include <string>
+#include <memory>
+#include <algorithm>
+
+namespace NS_NAME {
+
+    // culled instance (std430, 32 bytes), instance_id is written as base instance
+    struct instance_bounds {
+        glm::vec4 sphere = glm::vec4(0.f); // world center, radius
+        GLuint index_count = 0;
+        GLuint first_index = 0;
+        GLint base_vertex = 0;
+        GLuint instance_id = 0;
+    };
+
+
+    namespace culling_source {
+
+        const char * cull = R"(#version 460 core
+layout(local_size_x = 64) in;
+struct instance_bounds { vec4 sphere; uint index_count; uint first_index; int base_vertex; uint instance_id; };
+struct draw_command { uint count; uint instance_count; uint first_index; int base_vertex; uint base_instance; };
+layout(std430, binding = 0) readonly buffer Instances { instance_bounds instances[]; };
+layout(std430, binding = 1) writeonly buffer Commands { draw_command commands_out[]; };
+layout(std430, binding = 2) buffer Counter { uint draw_count; };
+layout(binding = 0) uniform sampler2D pyramid;
+uniform mat4 view_proj;
+uniform vec4 planes[6];
+uniform uint instance_count;
+uniform uint max_draws;
+uniform uint use_hiz;
+uniform int pyramid_levels;
+
+bool frustum_visible(vec3 c, float r) {
+    for (int i = 0; i < 6; i++) if (dot(planes[i].xyz, c) + planes[i].w < -r) return false;
+    return true;
+}
+
+// level where rect spans at most 2x2 texels
+bool occluded(vec3 c, float r) {
+    vec3 lo = vec3(1e30), hi = vec3(-1e30);
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = c + r * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = view_proj * vec4(corner, 1.0);
+        if (clip.w <= 0.0) return false;
+        vec3 ndc = clip.xyz / clip.w;
+        lo = min(lo, ndc);
+        hi = max(hi, ndc);
+    }
+    vec2 uv_lo = clamp(lo.xy * 0.5 + 0.5, 0.0, 1.0), uv_hi = clamp(hi.xy * 0.5 + 0.5, 0.0, 1.0);
+    vec2 extent = (uv_hi - uv_lo) * vec2(textureSize(pyramid, 0));
+    int level = int(ceil(log2(max(max(extent.x, extent.y), 1.0))));
+    if (level >= pyramid_levels) return false;
+
+    ivec2 size = textureSize(pyramid, level);
+    ivec2 a = min(ivec2(uv_lo * vec2(size)), size - 1), b = min(ivec2(uv_hi * vec2(size)), size - 1);
+    float d = max(max(texelFetch(pyramid, a, level).r, texelFetch(pyramid, ivec2(b.x, a.y), level).r),
+                  max(texelFetch(pyramid, ivec2(a.x, b.y), level).r, texelFetch(pyramid, b, level).r));
+    return lo.z * 0.5 + 0.5 > d;
+}
+
+void main() {
+    uint i = gl_GlobalInvocationID.x + gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 64u; // 2D grid past max group count
+    if (i >= instance_count) return;
+    instance_bounds inst = instances[i];
+    if (!frustum_visible(inst.sphere.xyz, inst.sphere.w)) return;
+    if (use_hiz != 0u && occluded(inst.sphere.xyz, inst.sphere.w)) return;
+
+    uint slot = atomicAdd(draw_count, 1u);
+    if (slot >= max_draws) return;
+    commands_out[slot] = draw_command(inst.index_count, 1u, inst.first_index, inst.base_vertex, inst.instance_id);
+}
+)";
+    };
+
+
+    // max-reduced depth mip chain, level 0 is previous power of two of depth size
+    class depth_pyramid {
+    protected:
+        downsampler reducer;
+        sampler point;
+        std::unique_ptr<texture> pyramid;
+        glm::uvec2 depth_extent = glm::uvec2(0);
+        GLsizei mip_levels = 0;
+
+        static GLuint previous_pow2(GLuint v) {
+            GLuint p = 1;
+            while (p * 2 <= v) p *= 2;
+            return p;
+        }
+
+    public:
+        depth_pyramid() {
+            point.parameter_val<int>(GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+            point.parameter_val<int>(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            point.parameter_val<int>(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            point.parameter_val<int>(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+
+        // depth texture (any depth format, single sampled) of given size
+        void build(texture& depth, glm::uvec2 size) {
+            const glm::uvec2 level_size(previous_pow2(size.x), previous_pow2(size.y));
+            if (size != depth_extent || !pyramid) {
+                depth_extent = size;
+                mip_levels = 1;
+                for (glm::uvec2 s = level_size; s.x > 1 || s.y > 1; s = glm::max(s / 2u, glm::uvec2(1))) mip_levels++;
+                pyramid = std::make_unique<texture>(texture_target::texture2d);
+                pyramid->storage(mip_levels, internal_format::r32f, level_size);
+            }
+            reducer.reduce(depth, 0, size, *pyramid, 0, level_size, mip_levels, GL_R32F, downsample_mode::max);
+        }
+
+        bool valid() const {
+            return bool(pyramid);
+        }
+
+        texture& get() {
+            return *pyramid;
+        }
+
+        sampler& get_sampler() {
+            return point;
+        }
+
+        glm::uvec2 depth_size() const {
+            return depth_extent;
+        }
+
+        GLsizei levels() const {
+            return mip_levels;
+        }
+    };
+
+
+    // frustum and Hi-Z instance culling into indirect draw commands with GPU draw count
+    class gpu_culler {
+    protected:
+        program cull_prog;
+        buffer command_buf;
+        buffer count_buf;
+        GLuint capacity = 0;
+        GLuint max_groups_x = 65535;
+
+    public:
+        // capacity is max emitted draws per frame
+        gpu_culler(GLuint capacity) : cull_prog(GL_COMPUTE_SHADER, std::string(culling_source::cull)), capacity(capacity) {
+            GLint groups_x = 65535;
+            glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &groups_x);
+            max_groups_x = GLuint(std::max(groups_x, 1));
+            command_buf.storage(GLsizeiptr(capacity) * sizeof(draw_elements_indirect_command), nullptr, 0);
+            count_buf.storage(sizeof(GLuint), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        }
+
+        // normalized planes (left, right, bottom, top, near, far) of view projection
+        static void frustum_planes(const glm::mat4& view_proj, glm::vec4 * planes) {
+            glm::vec4 rows[4];
+            for (int i = 0; i < 4; i++) rows[i] = glm::vec4(view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]);
+            for (int i = 0; i < 3; i++) {
+                planes[i * 2 + 0] = rows[3] + rows[i];
+                planes[i * 2 + 1] = rows[3] - rows[i];
+            }
+            for (int i = 0; i < 6; i++) planes[i] /= glm::length(glm::vec3(planes[i]));
+        }
+
+        // instances is array of instance_bounds, pyramid (previous frame or prepass depth) enables occlusion test
+        void cull(buffer& instances, GLuint count, const glm::mat4& view_proj, depth_pyramid * pyramid = nullptr) {
+            const GLuint zero = 0;
+            count_buf.subdata(0, sizeof(GLuint), &zero);
+
+            glm::vec4 planes[6];
+            frustum_planes(view_proj, planes);
+
+            const bool hiz = pyramid && pyramid->valid();
+            managment.use_program(cull_prog);
+            buffer_binding(buffer_target::shader_storage, 0).bind(instances);
+            buffer_binding(buffer_target::shader_storage, 1).bind(command_buf);
+            buffer_binding(buffer_target::shader_storage, 2).bind(count_buf);
+            if (hiz) {
+                texture_binding(0).bind_texture(pyramid->get());
+                texture_binding(0).bind_sampler(pyramid->get_sampler());
+            }
+
+            cull_prog.get_uniform<glm::mat4>("view_proj") = view_proj;
+            glProgramUniform4fv(cull_prog, glGetUniformLocation(cull_prog, "planes"), 6, &planes[0].x);
+            cull_prog.get_uniform<GLuint>("instance_count") = count;
+            cull_prog.get_uniform<GLuint>("max_draws") = capacity;
+            cull_prog.get_uniform<GLuint>("use_hiz") = hiz ? 1u : 0u;
+            cull_prog.get_uniform<int>("pyramid_levels") = hiz ? int(pyramid->levels()) : 0;
+
+            const GLuint groups = (count + 63) / 64;
+            if (groups <= max_groups_x) dispatch.compute(glm::uvec3(groups, 1, 1));
+            else dispatch.compute(glm::uvec3(max_groups_x, (groups + max_groups_x - 1) / max_groups_x, 1));
+            commands.memory_barrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+
+        // one multi draw, count sourced from GPU (index buffer and vertex array bound by caller)
+        void draw(_mode& mode, GLenum type = GL_UNSIGNED_INT) {
+            buffer_target::draw_indirect.bind(command_buf);
+            buffer_target::parameter.bind(count_buf);
+            commands.draw_elements_indirect_count(mode, type, nullptr, 0, GLsizei(capacity), sizeof(draw_elements_indirect_command));
+        }
+
+        buffer& draw_commands() {
+            return command_buf;
+        }
+
+        // single GLuint, may exceed capacity (excess draws are dropped)
+        buffer& draw_count() {
+            return count_buf;
+        }
+
+        GLuint max_draws() const {
+            return capacity;
+        }
+    };
+
+};
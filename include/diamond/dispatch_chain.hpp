@@ -0,0 +1,219 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "buffer.hpp"
+#include "program.hpp"
+#include "command.hpp"
+#include "managment.hpp"
+#include <functional>
+#include <memory>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+namespace NS_NAME {
+
+    namespace dispatch_chain_source {
+
+        // GPU count (uint) into indirect arguments
+        const char * convert = R"(#version 460 core
+layout(local_size_x = 1) in;
+layout(std430, binding = 0) readonly buffer Counts { uint counts[]; };
+layout(std430, binding = 1) writeonly buffer Args { uint args[]; };
+uniform uint count_index;
+uniform uint arg_index;
+uniform uint kind;
+uniform uint divisor;
+uniform uint multiplier;
+uniform uint max_groups;
+uniform uint instances;
+
+void main() {
+    uint n = counts[count_index] * multiplier;
+    if (kind == 0u) {
+        args[arg_index + 0u] = min((n + divisor - 1u) / divisor, max_groups);
+        args[arg_index + 1u] = 1u;
+        args[arg_index + 2u] = 1u;
+    } else {
+        args[arg_index + 0u] = n;
+        args[arg_index + 1u] = instances;
+        args[arg_index + 2u] = 0u;
+        args[arg_index + 3u] = 0u;
+        if (kind == 2u) args[arg_index + 4u] = 0u;
+    }
+}
+)";
+    };
+
+
+    // GPU sized pipeline: passes write counts, later dispatches and draws are sized from them without readback
+    class dispatch_chain {
+    protected:
+        enum class step_kind { dispatch, dispatch_sized, draw_arrays, draw_elements, clear };
+
+        struct step {
+            step_kind kind;
+            std::function<void()> setup;
+            memory_barrier_bits after;
+            glm::uvec3 groups = glm::uvec3(1);
+            buffer * counts = nullptr;
+            GLuint count_index = 0;
+            GLuint divisor = 1;
+            GLuint multiplier = 1;
+            GLuint instances = 1;
+            GLuint arg_offset = 0; // bytes
+            _mode * mode = nullptr;
+            GLenum type = GL_UNSIGNED_INT;
+        };
+
+        std::unique_ptr<program> converter;
+        std::unique_ptr<buffer> args;
+        std::vector<step> steps;
+        GLuint args_bytes = 0;
+        GLuint max_groups = 65535;
+        bool shader_written = false; // passes ran since last clear, their counter writes must land before clearing
+
+        step& push(step_kind kind, std::function<void()> setup, memory_barrier_bits after) {
+            steps.push_back(step());
+            steps.back().kind = kind;
+            steps.back().setup = setup;
+            steps.back().after = after;
+            args.reset(); // layout changed
+            return steps.back();
+        }
+
+        GLuint reserve_args(GLuint bytes) {
+            const GLuint offset = args_bytes;
+            args_bytes += bytes;
+            return offset;
+        }
+
+        void convert(step& s, GLuint kind) {
+            managment.use_program(*converter);
+            buffer_binding(buffer_target::shader_storage, 0).bind(*s.counts);
+            buffer_binding(buffer_target::shader_storage, 1).bind(*args);
+            converter->get_uniform<GLuint>("count_index") = s.count_index;
+            converter->get_uniform<GLuint>("arg_index") = s.arg_offset / 4;
+            converter->get_uniform<GLuint>("kind") = kind;
+            converter->get_uniform<GLuint>("divisor") = s.divisor;
+            converter->get_uniform<GLuint>("multiplier") = s.multiplier;
+            converter->get_uniform<GLuint>("max_groups") = max_groups;
+            converter->get_uniform<GLuint>("instances") = s.instances;
+            dispatch.compute(1u);
+            commands.memory_barrier(GL_COMMAND_BARRIER_BIT);
+        }
+
+    public:
+        dispatch_chain() {
+            GLint groups_x = 65535;
+            glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &groups_x);
+            max_groups = GLuint(groups_x);
+        }
+
+        // zero counter range before passes append to it (ordered after earlier passes by buffer update barrier)
+        dispatch_chain& clear(buffer& counts, GLuint first_index, GLuint count = 1) {
+            step& s = push(step_kind::clear, nullptr, 0);
+            s.counts = &counts;
+            s.count_index = first_index;
+            s.instances = count;
+            return thisref;
+        }
+
+        // fixed size pass, setup binds program and resources, after is barrier of its writes
+        dispatch_chain& compute(std::function<void()> setup, glm::uvec3 groups, memory_barrier_bits after = GL_SHADER_STORAGE_BARRIER_BIT) {
+            push(step_kind::dispatch, setup, after).groups = groups;
+            return thisref;
+        }
+
+        // pass of ceil(counts[count_index] / items_per_group) workgroups
+        dispatch_chain& compute_sized(std::function<void()> setup, buffer& counts, GLuint count_index, GLuint items_per_group, memory_barrier_bits after = GL_SHADER_STORAGE_BARRIER_BIT) {
+            step& s = push(step_kind::dispatch_sized, setup, after);
+            s.counts = &counts;
+            s.count_index = count_index;
+            s.divisor = std::max(items_per_group, 1u);
+            return thisref;
+        }
+
+        // draw of counts[count_index] * vertices_per_item vertices (vertex array bound by setup)
+        dispatch_chain& draw_arrays(_mode& mode, std::function<void()> setup, buffer& counts, GLuint count_index, GLuint vertices_per_item = 1, GLuint instances = 1) {
+            step& s = push(step_kind::draw_arrays, setup, 0);
+            s.mode = &mode;
+            s.counts = &counts;
+            s.count_index = count_index;
+            s.multiplier = vertices_per_item;
+            s.instances = instances;
+            return thisref;
+        }
+
+        // indexed draw of counts[count_index] * indices_per_item indices (element buffer bound by setup)
+        dispatch_chain& draw_elements(_mode& mode, std::function<void()> setup, buffer& counts, GLuint count_index, GLuint indices_per_item = 1, GLuint instances = 1, GLenum type = GL_UNSIGNED_INT) {
+            step& s = push(step_kind::draw_elements, setup, 0);
+            s.mode = &mode;
+            s.counts = &counts;
+            s.count_index = count_index;
+            s.multiplier = indices_per_item;
+            s.instances = instances;
+            s.type = type;
+            return thisref;
+        }
+
+        // records steps in order, sized steps convert counts right before consuming them
+        void execute() {
+            if (!converter) converter = std::make_unique<program>(GL_COMPUTE_SHADER, std::string(dispatch_chain_source::convert));
+            if (!args) {
+                args_bytes = 0;
+                for (auto& s : steps) {
+                    if (s.kind == step_kind::dispatch_sized) s.arg_offset = reserve_args(sizeof(dispatch_indirect_command));
+                    if (s.kind == step_kind::draw_arrays) s.arg_offset = reserve_args(sizeof(draw_arrays_indirect_command));
+                    if (s.kind == step_kind::draw_elements) s.arg_offset = reserve_args(sizeof(draw_elements_indirect_command));
+                }
+                args = std::make_unique<buffer>();
+                args->storage(GLsizei(std::max(args_bytes, 16u)), nullptr, 0);
+            }
+
+            for (auto& s : steps) {
+                switch (s.kind) {
+                    case step_kind::clear:
+                        if (shader_written) commands.memory_barrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+                        shader_written = false;
+                        s.counts->clear_subdata(GLintptr(s.count_index) * 4, GLsizeiptr(s.instances) * 4);
+                        break;
+                    case step_kind::dispatch:
+                        s.setup();
+                        dispatch.compute(s.groups);
+                        break;
+                    case step_kind::dispatch_sized:
+                        convert(s, 0);
+                        s.setup();
+                        dispatch.compute_indirect(*args, s.arg_offset);
+                        break;
+                    case step_kind::draw_arrays:
+                        convert(s, 1);
+                        s.setup();
+                        buffer_target::draw_indirect.bind(*args);
+                        commands.draw_arrays_indirect(*s.mode, (const void *)(uintptr_t)s.arg_offset);
+                        break;
+                    case step_kind::draw_elements:
+                        convert(s, 2);
+                        s.setup();
+                        buffer_target::draw_indirect.bind(*args);
+                        commands.draw_elements_indirect(*s.mode, s.type, (const void *)(uintptr_t)s.arg_offset);
+                        break;
+                }
+                if (s.kind != step_kind::clear) shader_written = true;
+                commands.memory_barrier(s.after);
+            }
+        }
+
+        // arguments of sized steps (valid after first execute)
+        buffer& arguments() {
+            return *args;
+        }
+
+        void reset() {
+            steps.clear();
+            args.reset();
+        }
+    };
+
+};
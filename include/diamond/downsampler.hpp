@@ -0,0 +1,292 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "buffer.hpp"
+#include "texture.hpp"
+#include "program.hpp"
+#include "command.hpp"
+#include "managment.hpp"
+#include <string>
+#include <map>
+#include <memory>
+#include <algorithm>
+
+namespace NS_NAME {
+
+    // reduction of 2x2 (or footprint) texels
+    enum class downsample_mode { average, min, max };
+
+
+    namespace downsampler_source {
+
+        // 256 threads per 64x64 source tile, writes 6 levels (32x32 .. 1x1 per tile),
+        // last workgroup (global counter) continues from level 5 with up to 6 more
+        const char * spd = R"(
+layout(local_size_x = 256) in;
+layout(binding = 0) uniform sampler2D src;
+layout(IMAGE_FORMAT, binding = 0) coherent uniform image2D dst[LEVELS];
+layout(std430, binding = 0) coherent buffer Counter { uint counter; };
+uniform int src_level;
+uniform ivec2 src_size;
+uniform ivec2 dst_size;
+uniform uint num_tiles;
+shared vec4 s_data[32][32];
+shared bool s_last;
+
+vec4 reduce2(vec4 a, vec4 b) {
+#if MODE == 1
+    return min(a, b);
+#elif MODE == 2
+    return max(a, b);
+#else
+    return a + b;
+#endif
+}
+
+vec4 reduce4(vec4 a, vec4 b, vec4 c, vec4 d) {
+#if MODE == 0
+    return (a + b + c + d) * 0.25;
+#else
+    return reduce2(reduce2(a, b), reduce2(c, d));
+#endif
+}
+
+ivec2 level_size(int level) {
+    return max(dst_size >> level, ivec2(1));
+}
+
+void store(int level, ivec2 g, vec4 v) {
+    if (all(lessThan(g, level_size(level)))) imageStore(dst[level], g, v);
+}
+
+// first level: 2x2 box (average) or covering footprint (min, max)
+vec4 fetch_source(ivec2 g) {
+#if MODE == 0
+    ivec2 s = min(g * 2, src_size - 1), e = min(g * 2 + 1, src_size - 1);
+    return reduce4(texelFetch(src, s, src_level), texelFetch(src, ivec2(e.x, s.y), src_level),
+                   texelFetch(src, ivec2(s.x, e.y), src_level), texelFetch(src, e, src_level));
+#else
+    ivec2 lo = min((g * src_size) / dst_size, src_size - 1);
+    ivec2 hi = clamp(((g + 1) * src_size + dst_size - 1) / dst_size, lo + 1, src_size);
+    vec4 v = texelFetch(src, lo, src_level);
+    for (int y = lo.y; y < hi.y; y++) {
+        for (int x = lo.x; x < hi.x; x++) v = reduce2(v, texelFetch(src, ivec2(x, y), src_level));
+    }
+    return v;
+#endif
+}
+
+// shared memory levels [first, first + 5) of tile
+void downsample_shared(int first, ivec2 tile) {
+    uint lid = gl_LocalInvocationIndex;
+    for (int level = first; level < min(first + 5, LEVELS); level++) {
+        int n = 32 >> (level - first + 1);
+        ivec2 l = ivec2(int(lid) % n, int(lid) / n);
+        bool active = int(lid) < n * n;
+        ivec2 a = l * 2;
+        ivec2 b = min(a + 1, max(level_size(level - 1) - 1 - tile * n * 2, a));
+        vec4 v = vec4(0.0);
+        if (active) v = reduce4(s_data[a.y][a.x], s_data[a.y][b.x], s_data[b.y][a.x], s_data[b.y][b.x]);
+        barrier();
+        if (active) {
+            s_data[l.y][l.x] = v;
+            store(level, tile * n + l, v);
+        }
+        barrier();
+    }
+}
+
+void main() {
+    uint lid = gl_LocalInvocationIndex;
+    ivec2 tile = ivec2(gl_WorkGroupID.xy);
+
+    for (uint i = 0u; i < 4u; i++) {
+        uint idx = lid + i * 256u;
+        ivec2 l = ivec2(idx % 32u, idx / 32u);
+        ivec2 g = tile * 32 + l;
+        vec4 v = all(lessThan(g, dst_size)) ? fetch_source(g) : vec4(0.0);
+        store(0, g, v);
+        s_data[l.y][l.x] = v;
+    }
+    barrier();
+    downsample_shared(1, tile);
+
+#if LEVELS > 6
+    if (lid == 0u) {
+        memoryBarrierImage();
+        s_last = atomicAdd(counter, 1u) == num_tiles - 1u;
+    }
+    barrier();
+    if (!s_last) return;
+
+    ivec2 m = level_size(5) - 1;
+    for (uint i = 0u; i < 4u; i++) {
+        uint idx = lid + i * 256u;
+        ivec2 g = ivec2(idx % 32u, idx / 32u);
+        ivec2 s = min(g * 2, m), e = min(g * 2 + 1, m);
+        vec4 v = reduce4(imageLoad(dst[5], s), imageLoad(dst[5], ivec2(e.x, s.y)), imageLoad(dst[5], ivec2(s.x, e.y)), imageLoad(dst[5], e));
+        store(6, g, v);
+        s_data[g.y][g.x] = v;
+    }
+    barrier();
+    downsample_shared(7, ivec2(0));
+    if (lid == 0u) counter = 0u;
+#endif
+}
+)";
+    };
+
+
+    // single dispatch mip chain / min-max pyramid generator (up to 12 levels per dispatch)
+    class downsampler {
+    protected:
+        std::map<std::string, std::unique_ptr<program>> programs;
+        buffer counter;
+        sampler point;
+        GLsizei max_levels = 12;
+        std::string log;
+
+        // image format layout qualifier, empty when not image bindable
+        static const char * image_format(GLenum internal) {
+            switch (internal) {
+                case GL_RGBA32F: return "rgba32f";
+                case GL_RGBA16F: return "rgba16f";
+                case GL_RG32F: return "rg32f";
+                case GL_RG16F: return "rg16f";
+                case GL_R32F: return "r32f";
+                case GL_R16F: return "r16f";
+                case GL_R11F_G11F_B10F: return "r11f_g11f_b10f";
+                case GL_RGBA16: return "rgba16";
+                case GL_RGB10_A2: return "rgb10_a2";
+                case GL_RGBA8: return "rgba8";
+                case GL_RG16: return "rg16";
+                case GL_RG8: return "rg8";
+                case GL_R16: return "r16";
+                case GL_R8: return "r8";
+            }
+            return "";
+        }
+
+        program& get(GLenum internal, downsample_mode mode, GLsizei levels) {
+            const std::string key = std::string(image_format(internal)) + "/" + std::to_string(int(mode)) + "/" + std::to_string(levels);
+            auto found = programs.find(key);
+            if (found != programs.end()) return *found->second;
+
+            std::string source = "#version 460 core\n";
+            source += std::string("#define IMAGE_FORMAT ") + image_format(internal) + "\n";
+            source += "#define LEVELS " + std::to_string(levels) + "\n";
+            source += "#define MODE " + std::to_string(int(mode)) + "\n";
+            source += downsampler_source::spd;
+
+            auto prog = std::make_unique<program>(GL_COMPUTE_SHADER, source);
+            if (!prog->get_val<int>(GL_LINK_STATUS)) log += key + ": " + prog->info_log() + "\n";
+            return *programs.emplace(key, std::move(prog)).first->second;
+        }
+
+        // one dispatch, count <= max_levels and level 5 of destination fits one tile when count > 6
+        void pass(texture& src, GLint src_level, glm::ivec2 src_size, texture& dst, GLint dst_level, glm::ivec2 dst_size, GLsizei count, GLenum internal, downsample_mode mode) {
+            program& prog = get(internal, mode, count);
+            managment.use_program(prog);
+            texture_binding(0).bind_texture(src);
+            texture_binding(0).bind_sampler(point);
+            buffer_binding(buffer_target::shader_storage, 0).bind(counter);
+            for (GLsizei i = 0; i < count; i++) {
+                image(GLuint(i)).bind_texture(dst, dst_level + i, GL_FALSE, 0, GL_READ_WRITE, internal);
+            }
+
+            const glm::uvec2 tiles = glm::uvec2((dst_size + 31) / 32);
+            prog.get_uniform<int>("src_level") = src_level;
+            prog.get_uniform<glm::ivec2>("src_size") = src_size;
+            prog.get_uniform<glm::ivec2>("dst_size") = dst_size;
+            prog.get_uniform<GLuint>("num_tiles") = tiles.x * tiles.y;
+            dispatch.compute(tiles);
+            commands.memory_barrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+        }
+
+        static glm::ivec2 level_extent(texture& tex, GLint level) {
+            GLint w = 0, h = 0;
+            texture_level lv(tex, level);
+            lv.get_parameter_val<int>(GL_TEXTURE_WIDTH, &w);
+            lv.get_parameter_val<int>(GL_TEXTURE_HEIGHT, &h);
+            return glm::ivec2(w, h);
+        }
+
+    public:
+        downsampler() {
+            const GLuint zero = 0;
+            counter.storage(sizeof(GLuint), &zero, 0);
+
+            GLint units = 8, uniforms = 8;
+            glGetIntegerv(GL_MAX_IMAGE_UNITS, &units);
+            glGetIntegerv(GL_MAX_COMPUTE_IMAGE_UNIFORMS, &uniforms);
+            max_levels = std::max(GLsizei(1), std::min({ GLsizei(12), GLsizei(units), GLsizei(uniforms) }));
+
+            point.parameter_val<int>(GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+            point.parameter_val<int>(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            point.parameter_val<int>(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            point.parameter_val<int>(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+
+        // true when internal format can be written by downsampler
+        static bool supported(GLenum internal) {
+            return image_format(internal)[0] != 0;
+        }
+
+        // reduce src level into count levels of dst starting at dst_level (dst_size is its extent);
+        // min/max are conservative when dst extents are powers of two
+        void reduce(texture& src, GLint src_level, glm::uvec2 src_size, texture& dst, GLint dst_level, glm::uvec2 dst_size, GLsizei count, GLenum internal, downsample_mode mode) {
+            glm::ivec2 in_size(src_size), out_size(dst_size);
+            texture * in = &src;
+            GLint in_level = src_level;
+            while (count > 0) {
+                GLsizei n = std::min(count, max_levels);
+                const glm::ivec2 level5 = glm::max(out_size >> 5, glm::ivec2(1));
+                if (n > 6 && (level5.x > 64 || level5.y > 64)) n = 6;
+                pass(*in, in_level, in_size, dst, dst_level, out_size, n, internal, mode);
+
+                in = &dst;
+                in_level = dst_level + n - 1;
+                in_size = glm::max(out_size >> (n - 1), glm::ivec2(1));
+                out_size = glm::max(in_size / 2, glm::ivec2(1));
+                dst_level += n;
+                count -= n;
+            }
+            glBindSampler(0, 0);
+        }
+
+        // generate count levels after source level (0 for rest of chain), falls back to glGenerateTextureMipmap
+        // min and max need image bindable format, false (see info_log) otherwise
+        // reduce depth into separate r32f chain with reduce() instead (see depth_pyramid)
+        bool generate(texture_level source, GLsizei count = 0, downsample_mode mode = downsample_mode::average) {
+            texture& tex = source.get_texture();
+            GLint internal = 0, levels = 1;
+            source.get_parameter_val<int>(GL_TEXTURE_INTERNAL_FORMAT, &internal);
+            tex.get_parameter_val<int>(GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+
+            const GLint base = GLint(GLuint(source));
+            if (!count || base + 1 + count > levels) count = levels - base - 1;
+            if (count <= 0) return true;
+            if (!supported(GLenum(internal))) {
+                if (mode == downsample_mode::average) {
+                    tex.generate_mipmap();
+                    return true;
+                }
+                log += "min/max reduction of format " + std::to_string(internal) + " is not image bindable, reduce into r32f chain\n";
+                return false;
+            }
+
+            const glm::ivec2 size = level_extent(tex, base);
+            reduce(tex, base, glm::uvec2(size), tex, base + 1, glm::uvec2(glm::max(size / 2, glm::ivec2(1))), count, GLenum(internal), mode);
+            return true;
+        }
+
+        GLsizei levels_per_dispatch() const {
+            return max_levels;
+        }
+
+        std::string info_log() const {
+            return log;
+        }
+    };
+
+};
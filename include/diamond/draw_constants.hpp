@@ -0,0 +1,88 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "buffer.hpp"
+#include "command.hpp"
+#include "sync.hpp"
+#include <cstring>
+#include <cstdint>
+
+namespace NS_NAME {
+
+    namespace draw_constants_source {
+
+        // draw record index in vertex shader (gl_BaseInstance needs GL 4.6 or ARB_shader_draw_parameters)
+        const char * index = R"(
+#if __VERSION__ < 460
+#extension GL_ARB_shader_draw_parameters : require
+#define gl_BaseInstance gl_BaseInstanceARB
+#endif
+#define DRAW_INDEX uint(gl_BaseInstance)
+)";
+    };
+
+
+    // "push constant" records in streaming SSBO, record index is passed as base instance
+    // T is std430 record (array stride is sizeof(T)), shader reads records[DRAW_INDEX] and passes it to later stages (flat)
+    // base instance also offsets instanced attributes, so per draw data belongs in records instead
+    template<class T>
+    class draw_constants {
+    protected:
+        ring_buffer ring;
+        GLuint binding;
+
+    public:
+        // records in flight over frames (one fence per frame)
+        draw_constants(GLuint capacity, GLuint binding = 0) : ring(GLsizeiptr(capacity) * sizeof(T)), binding(binding) {}
+
+        // writes record, returns its index (base instance of draw)
+        GLuint push(const T& record) {
+            auto a = ring.allocate(sizeof(T), sizeof(T));
+            std::memcpy(a.data, &record, sizeof(T));
+            return GLuint(a.offset / GLintptr(sizeof(T)));
+        }
+
+        // once per frame, before draws reading records
+        void bind() {
+            buffer_binding(buffer_target::shader_storage, binding).bind(ring.get());
+        }
+
+        // after frame draws, records are reused when GPU passed the fence
+        void end_frame() {
+            ring.fence();
+        }
+
+        // indexed draw with its record
+        void draw_elements(_mode& mode, const T& record, GLsizei count, GLenum type = GL_UNSIGNED_INT, const GLvoid * indices = nullptr, GLint basevertex = 0, GLsizei instances = 1) {
+            commands.draw_elements_base_instance(mode, count, type, indices, instances, basevertex, this->push(record));
+        }
+
+        void draw_arrays(_mode& mode, const T& record, GLint first, GLsizei count, GLsizei instances = 1) {
+            commands.draw_arrays_base_instance(mode, first, count, instances, this->push(record));
+        }
+
+        // indirect command referencing its record
+        draw_elements_indirect_command command(const T& record, GLuint count, GLuint first_index = 0, GLint base_vertex = 0, GLuint instances = 1) {
+            draw_elements_indirect_command cmd;
+            cmd.count = count;
+            cmd.instance_count = instances;
+            cmd.first_index = first_index;
+            cmd.base_vertex = base_vertex;
+            cmd.base_instance = this->push(record);
+            return cmd;
+        }
+
+        buffer& get() {
+            return ring.get();
+        }
+
+        GLuint capacity() const {
+            return GLuint(ring.size() / GLsizeiptr(sizeof(T)));
+        }
+
+        uint64_t stall_count() const {
+            return ring.stall_count();
+        }
+    };
+
+};
@@ -35,6 +35,35 @@ namespace NS_NAME {
         GLenum type() const {
             return _type;
         }
+
+        // size of 4x4 block in bytes (zero when format is not block compressed)
+        GLsizei block_bytes() const {
+            switch (_internal) {
+                case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_RED_RGTC1:
+                case GL_COMPRESSED_SIGNED_RED_RGTC1:
+                    return 8;
+                case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+                case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+                case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+                case GL_COMPRESSED_RG_RGTC2:
+                case GL_COMPRESSED_SIGNED_RG_RGTC2:
+                case GL_COMPRESSED_RGBA_BPTC_UNORM:
+                case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+                case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+                case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+                    return 16;
+            }
+            return 0;
+        }
+
+        bool compressed() const {
+            return block_bytes() > 0;
+        }
     };
 
 
@@ -52,6 +81,7 @@ namespace NS_NAME {
         _internal_format rgba16i(GL_RGBA16I, GL_RGBA_INTEGER, GL_SHORT);
         _internal_format rgba32ui(GL_RGBA16UI, GL_RGBA_INTEGER, GL_UNSIGNED_INT);
         _internal_format rgba32i(GL_RGBA16I, GL_RGBA_INTEGER, GL_INT);
+        _internal_format srgb8_alpha8(GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE);
 
         // RGB
         _internal_format rgb32f(GL_RGB32F, GL_RGB, GL_FLOAT);
@@ -66,6 +96,7 @@ namespace NS_NAME {
         _internal_format rgb16i(GL_RGB16I, GL_RGB_INTEGER, GL_SHORT);
         _internal_format rgb32ui(GL_RGB16UI, GL_RGB_INTEGER, GL_UNSIGNED_INT);
         _internal_format rgb32i(GL_RGB16I, GL_RGB_INTEGER, GL_INT);
+        _internal_format srgb8(GL_SRGB8, GL_RGB, GL_UNSIGNED_BYTE);
 
         // RG
         _internal_format rg32f(GL_RG32F, GL_RG, GL_FLOAT);
@@ -94,6 +125,24 @@ namespace NS_NAME {
         _internal_format r16i(GL_R16I, GL_RED_INTEGER, GL_SHORT);
         _internal_format r32ui(GL_R16UI, GL_RED_INTEGER, GL_UNSIGNED_INT);
         _internal_format r32i(GL_R16I, GL_RED_INTEGER, GL_INT);
+
+        // Block compressed (4x4 blocks, format and type are of source pixels)
+        _internal_format bc1_rgb_unorm(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_RGB, GL_UNSIGNED_BYTE);
+        _internal_format bc1_rgb_srgb(GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, GL_RGB, GL_UNSIGNED_BYTE);
+        _internal_format bc1_rgba_unorm(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_RGBA, GL_UNSIGNED_BYTE);
+        _internal_format bc1_rgba_srgb(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, GL_RGBA, GL_UNSIGNED_BYTE);
+        _internal_format bc2_rgba_unorm(GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, GL_RGBA, GL_UNSIGNED_BYTE);
+        _internal_format bc2_rgba_srgb(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, GL_RGBA, GL_UNSIGNED_BYTE);
+        _internal_format bc3_rgba_unorm(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_RGBA, GL_UNSIGNED_BYTE);
+        _internal_format bc3_rgba_srgb(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, GL_RGBA, GL_UNSIGNED_BYTE);
+        _internal_format bc4_r_unorm(GL_COMPRESSED_RED_RGTC1, GL_RED, GL_UNSIGNED_BYTE);
+        _internal_format bc4_r_snorm(GL_COMPRESSED_SIGNED_RED_RGTC1, GL_RED, GL_BYTE);
+        _internal_format bc5_rg_unorm(GL_COMPRESSED_RG_RGTC2, GL_RG, GL_UNSIGNED_BYTE);
+        _internal_format bc5_rg_snorm(GL_COMPRESSED_SIGNED_RG_RGTC2, GL_RG, GL_BYTE);
+        _internal_format bc6h_rgb_ufloat(GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, GL_RGB, GL_HALF_FLOAT);
+        _internal_format bc6h_rgb_sfloat(GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT, GL_RGB, GL_HALF_FLOAT);
+        _internal_format bc7_rgba_unorm(GL_COMPRESSED_RGBA_BPTC_UNORM, GL_RGBA, GL_UNSIGNED_BYTE);
+        _internal_format bc7_rgba_srgb(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, GL_RGBA, GL_UNSIGNED_BYTE);
     };
 
     // you can pass these bitfields
@@ -187,5 +236,38 @@ namespace NS_NAME {
     };
 
 
+    struct memory_barrier_bits {
+        union {
+            struct {
+                GLbitfield vertex_attrib_array : 1;
+                GLbitfield element_array : 1;
+                GLbitfield uniform : 1;
+                GLbitfield texture_fetch : 1;
+                GLbitfield : 1;
+                GLbitfield shader_image_access : 1;
+                GLbitfield command : 1;
+                GLbitfield pixel_buffer : 1;
+                GLbitfield texture_update : 1;
+                GLbitfield buffer_update : 1;
+                GLbitfield framebuffer : 1;
+                GLbitfield transform_feedback : 1;
+                GLbitfield atomic_counter : 1;
+                GLbitfield shader_storage : 1;
+                GLbitfield client_mapped_buffer : 1;
+                GLbitfield query_buffer : 1;
+            };
+            GLbitfield bitfield = 0;
+        };
+
+        memory_barrier_bits() {
+
+        }
+
+        memory_barrier_bits(GLbitfield bitfield) {
+            this->bitfield = bitfield;
+        }
+    };
+
+
 
 };
\ No newline at end of file
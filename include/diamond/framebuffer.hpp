@@ -0,0 +1,204 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "texture.hpp"
+#include <vector>
+#include <algorithm>
+
+namespace NS_NAME {
+
+    // what happens to attachment contents at pass begin
+    enum class load_op { load, clear, dont_care };
+
+    // what happens to attachment contents at pass end
+    enum class store_op { store, dont_care };
+
+
+    class framebuffer_builder {
+    public:
+        static void create(GLuint * heap) {
+            glCreateFramebuffers(1, heap);
+        }
+        static void release(GLuint * heap) {
+            glDeleteFramebuffers(1, heap);
+        }
+        static void release_n(GLsizei n, const GLuint * heap) {
+            glDeleteFramebuffers(n, heap);
+        }
+    };
+
+
+    // framebuffer object (DSA) with explicit load/store semantics
+    class framebuffer: public gl_object<framebuffer_builder> {
+    protected:
+        using base = gl_object<framebuffer_builder>;
+
+        struct attachment_ops {
+            GLenum attachment = GL_COLOR_ATTACHMENT0;
+            load_op load = load_op::load;
+            store_op store = store_op::store;
+            glm::vec4 color = glm::vec4(0.f);
+            float depth = 1.f;
+            GLint stencil = 0;
+        };
+
+        std::vector<attachment_ops> ops;
+        std::vector<GLenum> draw_list = { GL_COLOR_ATTACHMENT0 };
+
+        attachment_ops& ops_of(GLenum attachment) {
+            for (auto& op : ops) if (op.attachment == attachment) return op;
+            ops.push_back(attachment_ops());
+            ops.back().attachment = attachment;
+            return ops.back();
+        }
+
+    public:
+
+        // constructor (variadic)
+        framebuffer() { base::create_alloc(); }
+        framebuffer(framebuffer& another) { base::move(another); ops = another.ops; draw_list = another.draw_list; } // copy (it refs)
+        framebuffer(framebuffer&& another) { base::move(std::forward<framebuffer>(another)); ops = std::move(another.ops); draw_list = std::move(another.draw_list); } // move
+        framebuffer(GLuint * another) { base::move(another); } // heap by ptr (zero is default framebuffer)
+
+
+        // attachments
+        void attach(GLenum attachment, texture& tex, GLint level = 0) {
+            glNamedFramebufferTexture(thisref, attachment, tex, level);
+        }
+
+        void attach_layer(GLenum attachment, texture& tex, GLint level, GLint layer) {
+            glNamedFramebufferTextureLayer(thisref, attachment, tex, level, layer);
+        }
+
+        void draw_buffers(const std::vector<GLenum>& buffers) {
+            draw_list = buffers;
+            glNamedFramebufferDrawBuffers(thisref, GLsizei(buffers.size()), buffers.data());
+        }
+
+        void draw_buffer(GLenum buffer) {
+            draw_list = { buffer };
+            glNamedFramebufferDrawBuffer(thisref, buffer);
+        }
+
+        void read_buffer(GLenum buffer) {
+            glNamedFramebufferReadBuffer(thisref, buffer);
+        }
+
+        GLenum status(GLenum target = GL_DRAW_FRAMEBUFFER) const {
+            return glCheckNamedFramebufferStatus(thisref, target);
+        }
+
+        bool complete(GLenum target = GL_DRAW_FRAMEBUFFER) const {
+            return status(target) == GL_FRAMEBUFFER_COMPLETE;
+        }
+
+
+        // clear by draw buffer index (affected by scissor and write masks)
+        void clear_color(GLint draw_buffer, glm::vec4 color) {
+            glClearNamedFramebufferfv(thisref, GL_COLOR, draw_buffer, &color.x);
+        }
+
+        void clear_color(GLint draw_buffer, glm::ivec4 color) {
+            glClearNamedFramebufferiv(thisref, GL_COLOR, draw_buffer, &color.x);
+        }
+
+        void clear_color(GLint draw_buffer, glm::uvec4 color) {
+            glClearNamedFramebufferuiv(thisref, GL_COLOR, draw_buffer, &color.x);
+        }
+
+        void clear_depth(float depth = 1.f) {
+            glClearNamedFramebufferfv(thisref, GL_DEPTH, 0, &depth);
+        }
+
+        void clear_stencil(GLint stencil = 0) {
+            glClearNamedFramebufferiv(thisref, GL_STENCIL, 0, &stencil);
+        }
+
+        void clear_depth_stencil(float depth = 1.f, GLint stencil = 0) {
+            glClearNamedFramebufferfi(thisref, GL_DEPTH_STENCIL, 0, depth, stencil);
+        }
+
+
+        // discard contents (no load from or store to memory)
+        void invalidate(const std::vector<GLenum>& attachments) {
+            if (!attachments.empty()) glInvalidateNamedFramebufferData(thisref, GLsizei(attachments.size()), attachments.data());
+        }
+
+        void invalidate(const std::vector<GLenum>& attachments, glm::ivec2 offset, glm::uvec2 size) {
+            if (!attachments.empty()) glInvalidateNamedFramebufferSubData(thisref, GLsizei(attachments.size()), attachments.data(), offset.x, offset.y, size.x, size.y);
+        }
+
+
+        // blit rectangles (x0, y0, x1, y1) into destination
+        void blit(framebuffer& destination, glm::ivec4 src, glm::ivec4 dst, GLbitfield mask = GL_COLOR_BUFFER_BIT, GLenum filter = GL_NEAREST) const {
+            glBlitNamedFramebuffer(thisref, destination, src.x, src.y, src.z, src.w, dst.x, dst.y, dst.z, dst.w, mask, filter);
+        }
+
+        // MSAA resolve of read buffer into destination of same size
+        void resolve(framebuffer& destination, glm::uvec2 size, GLbitfield mask = GL_COLOR_BUFFER_BIT) const {
+            glm::ivec4 rect(0, 0, size.x, size.y);
+            this->blit(destination, rect, rect, mask, GL_NEAREST);
+        }
+
+
+        // pass load/store setup (attachment enum, e.g. GL_COLOR_ATTACHMENT1 or GL_DEPTH_ATTACHMENT)
+        framebuffer& load(GLenum attachment, load_op op) {
+            ops_of(attachment).load = op;
+            return thisref;
+        }
+
+        framebuffer& store(GLenum attachment, store_op op) {
+            ops_of(attachment).store = op;
+            return thisref;
+        }
+
+        framebuffer& load_clear(GLenum attachment, glm::vec4 color) {
+            auto& op = ops_of(attachment);
+            op.load = load_op::clear;
+            op.color = color;
+            return thisref;
+        }
+
+        framebuffer& load_clear(GLenum attachment, float depth, GLint stencil = 0) {
+            auto& op = ops_of(attachment);
+            op.load = load_op::clear;
+            op.depth = depth;
+            op.stencil = stencil;
+            return thisref;
+        }
+
+        // bind as draw framebuffer and apply load ops
+        void begin_pass() {
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, thisref);
+
+            std::vector<GLenum> discard;
+            for (auto& op : ops) {
+                if (op.load == load_op::dont_care) discard.push_back(op.attachment);
+            }
+            this->invalidate(discard);
+
+            for (auto& op : ops) {
+                if (op.load != load_op::clear) continue;
+                switch (op.attachment) {
+                    case GL_DEPTH_ATTACHMENT: this->clear_depth(op.depth); break;
+                    case GL_STENCIL_ATTACHMENT: this->clear_stencil(op.stencil); break;
+                    case GL_DEPTH_STENCIL_ATTACHMENT: this->clear_depth_stencil(op.depth, op.stencil); break;
+                    default: {
+                        auto found = std::find(draw_list.begin(), draw_list.end(), op.attachment);
+                        if (found != draw_list.end()) this->clear_color(GLint(found - draw_list.begin()), op.color);
+                    }
+                }
+            }
+        }
+
+        // apply store ops (after resolves and reads of pass results)
+        void end_pass() {
+            std::vector<GLenum> discard;
+            for (auto& op : ops) {
+                if (op.store == store_op::dont_care) discard.push_back(op.attachment);
+            }
+            this->invalidate(discard);
+        }
+    };
+
+};
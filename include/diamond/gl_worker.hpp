@@ -0,0 +1,188 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "parallel.hpp"
+#include "sync.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <type_traits>
+#include <exception>
+
+namespace NS_NAME {
+
+    struct gl_worker_stats {
+        uint64_t submitted = 0;
+        uint64_t executed = 0;  // on worker
+        uint64_t delivered = 0; // handed to render thread
+    };
+
+
+    // resource thread owning a context shared with render context (uploads, compiles, program links)
+    // make_current is called on worker thread first (e.g. hidden GLFW window or headless EGL context created with sharing)
+    // results are handed back by poll() on render thread after worker fence signals, so created names are safe to use there
+    // only shareable objects (buffers, textures, samplers, shaders, programs) may cross, not vertex arrays or framebuffers
+    class gl_worker {
+    protected:
+        struct completion {
+            std::shared_ptr<NS_NAME::fence> guard;
+            std::function<void()> deliver;
+        };
+
+        mpsc_queue<std::function<void()>> jobs;
+        mpsc_queue<completion> done; // render thread consumes
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::atomic<bool> stopping{ false };
+        std::atomic<uint64_t> submitted{ 0 };
+        std::atomic<uint64_t> executed{ 0 };
+        uint64_t delivered = 0;
+        completion waiting; // head of done, fence not yet signaled
+        bool has_waiting = false;
+        std::thread thread;
+
+        void worker_loop(std::function<void()> make_current, std::function<void()> release_current) {
+            if (make_current) make_current();
+            std::function<void()> job;
+            for (;;) {
+                while (jobs.pop(job)) {
+                    job();
+                    job = nullptr;
+                    executed++;
+                }
+                std::unique_lock<std::mutex> lock(mtx);
+                if (stopping && jobs.empty()) break;
+                cv.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            }
+            if (release_current) release_current();
+        }
+
+        void wake() {
+            { std::lock_guard<std::mutex> lock(mtx); }
+            cv.notify_one();
+        }
+
+        // runs on worker: fence after work, flushed so render context can see it
+        void finish(std::function<void()> deliver) {
+            auto guard = std::make_shared<NS_NAME::fence>();
+            guard->insert();
+            glFlush();
+            done.push({ guard, std::move(deliver) });
+        }
+
+    public:
+        gl_worker(std::function<void()> make_current, std::function<void()> release_current = nullptr) {
+            thread = std::thread([this, make_current, release_current]() { worker_loop(make_current, release_current); });
+        }
+
+        gl_worker(const gl_worker&) = delete;
+
+        // pending jobs are executed, undelivered results are dropped
+        ~gl_worker() {
+            stopping = true;
+            wake();
+            thread.join();
+        }
+
+        // work runs on worker context, future is ready after poll() sees its fence (holds exception work threw)
+        template<class F>
+        auto submit(F&& work) -> std::future<decltype(work())> {
+            using R = decltype(work());
+            auto promise = std::make_shared<std::promise<R>>();
+            std::future<R> result = promise->get_future();
+            auto fn = std::make_shared<typename std::decay<F>::type>(std::forward<F>(work));
+            submitted++;
+            jobs.push([this, promise, fn]() {
+                try {
+                    if constexpr (std::is_void<R>::value) {
+                        (*fn)();
+                        finish([promise]() { promise->set_value(); });
+                    } else {
+                        auto value = std::make_shared<R>((*fn)());
+                        finish([promise, value]() { promise->set_value(std::move(*value)); });
+                    }
+                } catch (...) {
+                    std::exception_ptr error = std::current_exception();
+                    finish([promise, error]() { promise->set_exception(error); });
+                }
+            });
+            wake();
+            return result;
+        }
+
+        // then(result) runs on render thread inside poll()
+        // when work throws, fail(exception_ptr) runs instead, without fail poll() rethrows it
+        template<class F, class T>
+        void submit(F&& work, T&& then) {
+            this->submit(std::forward<F>(work), std::forward<T>(then), std::function<void(std::exception_ptr)>());
+        }
+
+        template<class F, class T, class E>
+        void submit(F&& work, T&& then, E&& fail) {
+            using R = decltype(work());
+            auto fn = std::make_shared<typename std::decay<F>::type>(std::forward<F>(work));
+            auto next = std::make_shared<typename std::decay<T>::type>(std::forward<T>(then));
+            auto failed = std::make_shared<std::function<void(std::exception_ptr)>>(std::forward<E>(fail));
+            submitted++;
+            jobs.push([this, fn, next, failed]() {
+                try {
+                    if constexpr (std::is_void<R>::value) {
+                        (*fn)();
+                        finish([next]() { (*next)(); });
+                    } else {
+                        auto value = std::make_shared<R>((*fn)());
+                        finish([next, value]() { (*next)(std::move(*value)); });
+                    }
+                } catch (...) {
+                    std::exception_ptr error = std::current_exception();
+                    finish([failed, error]() {
+                        if (*failed) (*failed)(error);
+                        else std::rethrow_exception(error);
+                    });
+                }
+            });
+            wake();
+        }
+
+        // render thread: delivers results whose fences signaled (in submit order), never blocks
+        size_t poll() {
+            size_t count = 0;
+            for (;;) {
+                if (!has_waiting) {
+                    if (!done.pop(waiting)) break;
+                    has_waiting = true;
+                }
+                if (!waiting.guard->signaled()) break;
+                completion current = std::move(waiting); // counted before deliver, it may throw
+                waiting = completion();
+                has_waiting = false;
+                delivered++;
+                count++;
+                current.deliver();
+            }
+            return count;
+        }
+
+        // render thread: blocks until every submitted job is delivered
+        void finish_all() {
+            while (delivered < submitted.load()) {
+                if (!has_waiting && done.pop(waiting)) has_waiting = true;
+                if (has_waiting) waiting.guard->wait();
+                if (!this->poll()) std::this_thread::yield();
+            }
+        }
+
+        gl_worker_stats stats() const {
+            gl_worker_stats st;
+            st.submitted = submitted.load();
+            st.executed = executed.load();
+            st.delivered = delivered;
+            return st;
+        }
+    };
+
+};
@@ -0,0 +1,375 @@
+#pragma once
+
+#ifdef EXPERIMENTAL_GLTF
+
+#include "opengl.hpp"
+#include "buffer.hpp"
+#include "texture.hpp"
+#include "vertex_array.hpp"
+#include "command.hpp"
+#include "parallel.hpp"
+#include "mapped_file.hpp"
+#include "sync.hpp"
+#include "sampler_cache.hpp"
+#include "tiny_gltf.h"
+#include "glm/gtc/quaternion.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace NS_NAME {
+
+    // fixed attribute locations of glTF semantics
+    namespace gltf_location {
+        const GLuint position = 0;
+        const GLuint normal = 1;
+        const GLuint texcoord0 = 2;
+        const GLuint tangent = 3;
+        const GLuint color0 = 4;
+        const GLuint joints0 = 5;
+        const GLuint weights0 = 6;
+        const GLuint texcoord1 = 7;
+    };
+
+
+    struct gltf_primitive {
+        std::shared_ptr<vertex_array> vao;
+        GLenum mode = GL_TRIANGLES;
+        GLsizei count = 0;          // indices (or vertices when not indexed)
+        GLenum index_type = 0;      // zero when not indexed
+        GLintptr index_offset = 0;  // bytes in geometry buffer
+        int material = -1;
+
+        void draw(GLsizei instances = 1) const {
+            glBindVertexArray(*vao);
+            if (index_type) _mode(mode).elements(count, index_type, (const GLvoid *)index_offset, instances);
+            else _mode(mode).arrays(0, count, instances);
+        }
+    };
+
+    struct gltf_mesh {
+        std::vector<gltf_primitive> primitives;
+    };
+
+    // flattened scene node referencing mesh
+    struct gltf_instance {
+        int mesh = -1;
+        int node = -1;
+        glm::mat4 transform = glm::mat4(1.f);
+    };
+
+    // glTF texture (image + sampler), image texture is null until uploaded
+    struct gltf_texture {
+        int image = -1;
+        int sampler = -1;
+    };
+
+
+    // glTF 2.0 / GLB scene: geometry streamed through mapped staging ring,
+    // images decoded on pool and created on render thread by poll()
+    class gltf_scene {
+    protected:
+        struct decoded_image {
+            std::vector<uint8_t> pixels;
+            int width = 0;
+            int height = 0;
+        };
+
+        struct encoded_image {
+            int index;
+            std::vector<uint8_t> bytes;
+        };
+
+        struct pending_image {
+            int index;
+            std::future<decoded_image> job;
+        };
+
+        thread_pool * pool;
+        GLsizeiptr staging_bytes;
+        tinygltf::Model gltf;
+        std::string errors, warnings;
+
+        std::unique_ptr<buffer> geometry;
+        std::vector<gltf_mesh> mesh_list;
+        std::vector<gltf_instance> instance_list;
+        std::vector<gltf_texture> texture_list;
+        std::vector<std::shared_ptr<texture>> image_textures;
+        std::vector<std::shared_ptr<sampler>> sampler_list;
+        std::vector<pending_image> pending;
+        std::vector<encoded_image> encoded;
+        std::unordered_set<int> srgb_images;
+
+        // tinygltf image callback, keeps encoded bytes for pool decode
+        static bool defer_image(tinygltf::Image *, const int index, std::string *, std::string *, int, int, const unsigned char * bytes, int size, void * user) {
+            auto * self = (gltf_scene *)user;
+            self->encoded.push_back({ index, std::vector<uint8_t>(bytes, bytes + size) });
+            return true;
+        }
+
+        static std::string directory_of(const std::string& path) {
+            const size_t slash = path.find_last_of("/\\");
+            return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+        }
+
+        static glm::mat4 local_transform(const tinygltf::Node& node) {
+            if (node.matrix.size() == 16) {
+                glm::mat4 m;
+                for (int i = 0; i < 16; i++) m[i / 4][i % 4] = float(node.matrix[i]);
+                return m;
+            }
+            glm::mat4 m(1.f);
+            if (node.translation.size() == 3) m = glm::translate(m, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
+            if (node.rotation.size() == 4) m = m * glm::mat4_cast(glm::quat(float(node.rotation[3]), float(node.rotation[0]), float(node.rotation[1]), float(node.rotation[2])));
+            if (node.scale.size() == 3) m = glm::scale(m, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+            return m;
+        }
+
+        void traverse(int node, const glm::mat4& parent) {
+            const auto& n = gltf.nodes[node];
+            const glm::mat4 world = parent * local_transform(n);
+            if (n.mesh >= 0) instance_list.push_back({ n.mesh, node, world });
+            for (int child : n.children) traverse(child, world);
+        }
+
+        // used buffer views into one device buffer, copied in parallel through staging ring
+        std::vector<GLintptr> upload_views() {
+            std::vector<bool> used(gltf.bufferViews.size(), false);
+            for (const auto& mesh : gltf.meshes) {
+                for (const auto& prim : mesh.primitives) {
+                    for (const auto& attr : prim.attributes) {
+                        const auto& acc = gltf.accessors[attr.second];
+                        if (acc.bufferView >= 0) used[acc.bufferView] = true;
+                    }
+                    if (prim.indices >= 0 && gltf.accessors[prim.indices].bufferView >= 0) used[gltf.accessors[prim.indices].bufferView] = true;
+                }
+            }
+
+            std::vector<GLintptr> offsets(gltf.bufferViews.size(), -1);
+            GLintptr total = 0;
+            for (size_t i = 0; i < used.size(); i++) {
+                if (!used[i]) continue;
+                offsets[i] = total;
+                total += (GLintptr(gltf.bufferViews[i].byteLength) + 15) / 16 * 16;
+            }
+            geometry = std::make_unique<buffer>();
+            geometry->storage(GLsizeiptr(std::max(total, GLintptr(16))), nullptr, 0);
+
+            ring_buffer staging(staging_bytes);
+            const size_t chunk = size_t(staging_bytes / 2);
+            for (size_t i = 0; i < used.size(); i++) {
+                if (!used[i]) continue;
+                const auto& view = gltf.bufferViews[i];
+                const uint8_t * src = gltf.buffers[view.buffer].data.data() + view.byteOffset;
+                for (size_t done = 0; done < view.byteLength; done += chunk) {
+                    const size_t bytes = std::min(chunk, view.byteLength - done);
+                    auto dst = staging.allocate(GLsizeiptr(bytes), 16);
+                    pool->parallel_for(0, bytes, 1 << 20, [&](size_t b, size_t e) {
+                        std::memcpy(dst.data + b, src + done + b, e - b);
+                    });
+                    staging.get().copydata(*geometry, dst.offset, offsets[i] + GLintptr(done), GLsizeiptr(bytes));
+                    staging.fence();
+                }
+            }
+            return offsets;
+        }
+
+        void build_meshes(const std::vector<GLintptr>& view_offsets) {
+            static const std::unordered_map<std::string, GLuint> locations = {
+                { "POSITION", gltf_location::position }, { "NORMAL", gltf_location::normal },
+                { "TEXCOORD_0", gltf_location::texcoord0 }, { "TANGENT", gltf_location::tangent },
+                { "COLOR_0", gltf_location::color0 }, { "JOINTS_0", gltf_location::joints0 },
+                { "WEIGHTS_0", gltf_location::weights0 }, { "TEXCOORD_1", gltf_location::texcoord1 }
+            };
+
+            for (const auto& mesh : gltf.meshes) {
+                mesh_list.emplace_back();
+                for (const auto& prim : mesh.primitives) {
+                    gltf_primitive out;
+                    out.vao = std::make_shared<vertex_array>();
+                    out.mode = GLenum(prim.mode < 0 ? GL_TRIANGLES : prim.mode);
+                    out.material = prim.material;
+
+                    for (const auto& attr : prim.attributes) {
+                        auto loc = locations.find(attr.first);
+                        if (loc == locations.end()) continue;
+                        const auto& acc = gltf.accessors[attr.second];
+                        if (acc.bufferView < 0 || acc.sparse.isSparse) { warnings += "unsupported accessor for " + attr.first + "\n"; continue; }
+
+                        const auto& view = gltf.bufferViews[acc.bufferView];
+                        const GLint components = tinygltf::GetNumComponentsInType(acc.type);
+                        const GLsizei stride = view.byteStride ? GLsizei(view.byteStride) : GLsizei(components * tinygltf::GetComponentSizeInBytes(acc.componentType));
+                        out.vao->vertex_buffer(loc->second, *geometry, view_offsets[acc.bufferView] + GLintptr(acc.byteOffset), stride);
+
+                        auto attrib = out.vao->create_attribute(loc->second);
+                        if (attr.first == "JOINTS_0") attrib.attrib_format_int(components, GLenum(acc.componentType), 0);
+                        else attrib.attrib_format(components, GLenum(acc.componentType), acc.normalized, 0);
+                        attrib.binding(loc->second);
+
+                        if (loc->second == gltf_location::position && prim.indices < 0) out.count = GLsizei(acc.count);
+                    }
+
+                    if (prim.indices >= 0) {
+                        const auto& acc = gltf.accessors[prim.indices];
+                        out.index_type = GLenum(acc.componentType);
+                        out.count = GLsizei(acc.count);
+                        out.index_offset = view_offsets[acc.bufferView] + GLintptr(acc.byteOffset);
+                        out.vao->element_buffer(*geometry);
+                    }
+                    mesh_list.back().primitives.push_back(out);
+                }
+            }
+        }
+
+        void build_samplers() {
+            for (const auto& s : gltf.samplers) {
+                sampler_desc desc;
+                desc.filter(s.minFilter > 0 ? s.minFilter : GL_LINEAR_MIPMAP_LINEAR, s.magFilter > 0 ? s.magFilter : GL_LINEAR);
+                desc.wrap_s = s.wrapS;
+                desc.wrap_t = s.wrapT;
+                sampler_list.push_back(default_sampler_cache().get(desc));
+            }
+            for (const auto& t : gltf.textures) texture_list.push_back({ t.source, t.sampler });
+
+            // color textures are sRGB encoded
+            for (const auto& m : gltf.materials) {
+                for (int t : { m.pbrMetallicRoughness.baseColorTexture.index, m.emissiveTexture.index }) {
+                    if (t >= 0 && gltf.textures[t].source >= 0) srgb_images.insert(gltf.textures[t].source);
+                }
+            }
+        }
+
+        void decode_images() {
+            image_textures.assign(gltf.images.size(), nullptr);
+            for (auto& e : encoded) {
+                auto bytes = std::make_shared<std::vector<uint8_t>>(std::move(e.bytes));
+                pending.push_back({ e.index, pool->submit([bytes]() {
+                    decoded_image out;
+                    int comp = 0;
+                    stbi_uc * pixels = stbi_load_from_memory(bytes->data(), int(bytes->size()), &out.width, &out.height, &comp, 4);
+                    if (pixels) {
+                        out.pixels.assign(pixels, pixels + size_t(out.width) * size_t(out.height) * 4);
+                        stbi_image_free(pixels);
+                    }
+                    return out;
+                }) });
+            }
+            encoded.clear();
+        }
+
+        void create_texture(int index, decoded_image& image) {
+            if (image.pixels.empty()) { warnings += "image " + std::to_string(index) + " decode failed\n"; return; }
+            const glm::uvec2 size(image.width, image.height);
+            GLsizei levels = 1;
+            for (GLuint s = std::max(size.x, size.y); s > 1; s /= 2) levels++;
+
+            auto tex = std::make_shared<texture>(texture_target::texture2d);
+            tex->storage(levels, srgb_images.count(index) ? internal_format::srgb8_alpha8 : internal_format::rgba8_unorm, size);
+            GLint alignment = 4;
+            glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4); // caller may have set 8
+            tex->subimage(0, glm::ivec2(0), size, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+            glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+            tex->generate_mipmap();
+            image_textures[index] = tex;
+        }
+
+    public:
+        // staging_bytes bounds mapped memory used for geometry streaming
+        gltf_scene(thread_pool& pool = default_pool(), GLsizeiptr staging_bytes = GLsizeiptr(64) << 20) : pool(&pool), staging_bytes(staging_bytes) {}
+
+        // .gltf or .glb, geometry is on GPU after return, textures arrive through poll()
+        bool load(const std::string& path) {
+            mapped_file file;
+            if (!file.open(path)) { errors = "cannot open " + path; return false; }
+
+            tinygltf::TinyGLTF loader;
+            loader.SetImageLoader(&gltf_scene::defer_image, this);
+            const bool binary = file.size() >= 4 && std::memcmp(file.data(), "glTF", 4) == 0;
+            const bool ok = binary
+                ? loader.LoadBinaryFromMemory(&gltf, &errors, &warnings, file.data(), unsigned(file.size()), directory_of(path))
+                : loader.LoadASCIIFromString(&gltf, &errors, &warnings, (const char *)file.data(), unsigned(file.size()), directory_of(path));
+            file.close();
+            if (!ok) return false;
+
+            decode_images(); // decode overlaps geometry streaming
+            build_samplers();
+            build_meshes(upload_views());
+
+            const int scene = gltf.defaultScene >= 0 ? gltf.defaultScene : 0;
+            if (scene < int(gltf.scenes.size())) {
+                for (int node : gltf.scenes[scene].nodes) traverse(node, glm::mat4(1.f));
+            }
+
+            // CPU copies are no longer needed
+            for (auto& b : gltf.buffers) std::vector<unsigned char>().swap(b.data);
+            return true;
+        }
+
+        // render thread: creates textures of decoded images, true when all are done
+        bool poll() {
+            size_t kept = 0;
+            for (size_t i = 0; i < pending.size(); i++) {
+                if (pending[i].job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                    if (kept != i) pending[kept] = std::move(pending[i]);
+                    kept++;
+                    continue;
+                }
+                decoded_image image = pending[i].job.get();
+                this->create_texture(pending[i].index, image);
+            }
+            pending.resize(kept);
+            return pending.empty();
+        }
+
+        bool ready() const {
+            return pending.empty();
+        }
+
+        std::string error() const {
+            return errors;
+        }
+
+        std::string warning() const {
+            return warnings;
+        }
+
+        // materials, animations and other metadata (buffer data released)
+        const tinygltf::Model& model() const {
+            return gltf;
+        }
+
+        buffer& geometry_buffer() {
+            return *geometry;
+        }
+
+        const std::vector<gltf_mesh>& meshes() const {
+            return mesh_list;
+        }
+
+        const std::vector<gltf_instance>& instances() const {
+            return instance_list;
+        }
+
+        const std::vector<gltf_texture>& textures() const {
+            return texture_list;
+        }
+
+        // null until uploaded
+        std::shared_ptr<texture> image_texture(int image) const {
+            return image >= 0 && image < int(image_textures.size()) ? image_textures[image] : nullptr;
+        }
+
+        std::shared_ptr<sampler> get_sampler(int index) const {
+            return index >= 0 && index < int(sampler_list.size()) ? sampler_list[index] : nullptr;
+        }
+    };
+
+};
+
+#endif
@@ -0,0 +1,253 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "buffer.hpp"
+#include "vertex_array.hpp"
+#include "command.hpp"
+#include "sync.hpp"
+#include "pipeline_state.hpp"
+#include "batch_culling.hpp"
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+namespace NS_NAME {
+
+    // indexed mesh range, draws with equal keys (and state) become one instanced draw
+    struct instanced_mesh {
+        GLuint vertex_array = 0;
+        _mode * mode = &draw_mode::triangles;
+        GLsizei count = 0;
+        GLenum type = GL_UNSIGNED_INT;
+        GLuint first_index = 0;
+        GLint base_vertex = 0;
+
+        bool operator==(const instanced_mesh& o) const {
+            return vertex_array == o.vertex_array && mode == o.mode && count == o.count && type == o.type && first_index == o.first_index && base_vertex == o.base_vertex;
+        }
+    };
+
+
+    struct instancing_stats {
+        uint64_t submitted = 0; // draws requested
+        uint64_t issued = 0;    // instanced draws emitted
+        uint64_t instances = 0;
+        uint64_t early_flushes = 0; // flushes forced by full instance stream
+
+        // fraction of draw calls removed
+        double reduction() const {
+            return submitted ? 1.0 - double(issued) / double(submitted) : 0.0;
+        }
+    };
+
+
+    // collects per frame draws of same mesh and state, emits one instanced draw per group
+    // transforms are kept and streamed as 4 column arrays (column k of all instances contiguous, 16 byte aligned)
+    // vertex shader reads them as layout(location = first_location) in mat4 instance_transform
+    // groups are drawn sorted by state, so use it for order independent (opaque) passes
+    class instancing_aggregator {
+    protected:
+        struct batch_key {
+            instanced_mesh mesh;
+            const pipeline_state * state = nullptr;
+
+            bool operator==(const batch_key& o) const {
+                return mesh == o.mesh && state == o.state;
+            }
+        };
+
+        struct batch_key_hash {
+            size_t operator()(const batch_key& k) const {
+                uint64_t h = 14695981039346656037ull;
+                auto mix = [&](uint64_t v) { h ^= v; h *= 1099511628211ull; };
+                mix(k.mesh.vertex_array);
+                mix(uint64_t(uintptr_t(k.mesh.mode)));
+                mix(uint64_t(k.mesh.count));
+                mix(k.mesh.type);
+                mix(k.mesh.first_index);
+                mix(uint64_t(uint32_t(k.mesh.base_vertex)));
+                mix(uint64_t(uintptr_t(k.state)));
+                return size_t(h);
+            }
+        };
+
+        struct batch {
+            batch_key key;
+            std::vector<glm::vec4> columns[4];
+
+            size_t size() const {
+                return columns[0].size();
+            }
+        };
+
+        ring_buffer ring;
+        GLuint capacity;
+        GLuint first_location, first_binding;
+        std::unordered_map<batch_key, GLuint, batch_key_hash> lookup;
+        std::vector<batch> batches; // reused over frames, first `used` are live
+        GLuint used = 0;
+        GLuint queued = 0; // instances this frame
+        std::vector<GLuint> order;
+        std::vector<GLuint> fed; // vertex arrays pointed at current allocation
+        instancing_stats counters;
+
+        static GLuint index_size(GLenum type) {
+            return type == GL_UNSIGNED_BYTE ? 1 : type == GL_UNSIGNED_SHORT ? 2 : 4;
+        }
+
+        // group of key with room for count more instances (at most capacity - queued), flushes when stream is full
+        batch& group(const instanced_mesh& mesh, const pipeline_state * state, size_t count, size_t& room) {
+            if (queued >= capacity) {
+                counters.early_flushes++;
+                this->flush();
+            }
+            room = std::min(count, size_t(capacity - queued));
+            counters.submitted += room;
+            queued += GLuint(room);
+
+            const batch_key key{ mesh, state };
+            auto found = lookup.find(key);
+            if (found != lookup.end()) return batches[found->second];
+            const GLuint index = used++;
+            if (index == batches.size()) batches.emplace_back();
+            batches[index].key = key;
+            for (auto& c : batches[index].columns) c.clear();
+            lookup.emplace(key, index);
+            return batches[index];
+        }
+
+    public:
+        // capacity is instances per flush (more submissions flush early), ring keeps 3 flushes in flight
+        instancing_aggregator(GLuint capacity, GLuint first_location = 12, GLuint first_binding = 12)
+            : ring(GLsizeiptr(capacity) * sizeof(glm::mat4) * 3), capacity(capacity), first_location(first_location), first_binding(first_binding) {}
+
+        // declares instance transform attributes (divisor 1) on mesh vertex array, once per vertex array
+        void setup(vertex_array& vao) {
+            for (GLuint k = 0; k < 4; k++) {
+                auto column = vao.create_attribute(first_location + k);
+                column.attrib_format(4, GL_FLOAT, GL_FALSE, 0);
+                column.binding(first_binding + k);
+                vao.binding_divisor(first_binding + k, 1);
+            }
+        }
+
+        // state may be null when caller binds it (then vertex array is bound here)
+        void submit(const instanced_mesh& mesh, const glm::mat4& transform, const pipeline_state * state = nullptr) {
+            size_t room;
+            batch& b = this->group(mesh, state, 1, room);
+            for (int k = 0; k < 4; k++) b.columns[k].push_back(transform[k]);
+        }
+
+        // many instances of one mesh (e.g. batch_culler output), counts as count draws
+        void submit(const instanced_mesh& mesh, const glm::mat4 * transforms, size_t count, const pipeline_state * state = nullptr) {
+            while (count) {
+                size_t room;
+                batch& b = this->group(mesh, state, count, room);
+                for (int k = 0; k < 4; k++) {
+                    auto& column = b.columns[k];
+                    const size_t at = column.size();
+                    column.resize(at + room);
+                    for (size_t j = 0; j < room; j++) column[at + j] = transforms[j][k];
+                }
+                transforms += room;
+                count -= room;
+            }
+        }
+
+        // instances [begin, end) of structure of arrays transforms, packed to columns by batch_kernels::pack_columns
+        void submit(const instanced_mesh& mesh, const instance_soa& instances, size_t begin, size_t end, const pipeline_state * state = nullptr) {
+            while (begin < end) {
+                size_t room;
+                batch& b = this->group(mesh, state, end - begin, room);
+                const size_t at = b.size();
+                glm::vec4 * columns[4];
+                for (int k = 0; k < 4; k++) {
+                    b.columns[k].resize(at + room);
+                    columns[k] = b.columns[k].data() + at;
+                }
+                batch_kernels::pack_columns(instances, begin, begin + room, columns);
+                begin += room;
+            }
+        }
+
+        // writes instance stream and draws all groups, returns draws issued
+        GLuint flush() {
+            if (!used) return 0;
+
+            // one allocation per flush, batch i occupies [base_i, base_i + n_i) in each column
+            const GLsizeiptr column = GLsizeiptr(queued) * sizeof(glm::vec4);
+            auto alloc = ring.allocate(column * 4, sizeof(glm::vec4));
+            glm::vec4 * columns[4];
+            for (GLuint k = 0; k < 4; k++) columns[k] = reinterpret_cast<glm::vec4*>(alloc.data + column * k);
+
+            order.resize(used);
+            for (GLuint i = 0; i < used; i++) order[i] = i;
+            std::sort(order.begin(), order.end(), [&](GLuint a, GLuint b) {
+                const batch_key& ka = batches[a].key;
+                const batch_key& kb = batches[b].key;
+                const GLuint sa = ka.state ? ka.state->index() + 1 : 0;
+                const GLuint sb = kb.state ? kb.state->index() + 1 : 0;
+                if (sa != sb) return sa < sb;
+                return ka.mesh.vertex_array < kb.mesh.vertex_array;
+            });
+
+            GLuint base = 0;
+            GLuint bound_vao = 0;
+            bool vao_known = false;
+            fed.clear();
+            for (GLuint i : order) {
+                const batch& b = batches[i];
+                const GLuint n = GLuint(b.size());
+                for (GLuint k = 0; k < 4; k++) std::memcpy(columns[k] + base, b.columns[k].data(), size_t(n) * sizeof(glm::vec4));
+
+                const GLuint vao = b.key.mesh.vertex_array;
+                if (std::find(fed.begin(), fed.end(), vao) == fed.end()) {
+                    for (GLuint k = 0; k < 4; k++) glVertexArrayVertexBuffer(vao, first_binding + k, ring.get(), alloc.offset + column * k, sizeof(glm::vec4));
+                    fed.push_back(vao);
+                }
+
+                // vertex array is ours, state already bound only differs by it
+                if (b.key.state && pipeline_states.current() != b.key.state) {
+                    pipeline_states.apply(*b.key.state);
+                    bound_vao = b.key.state->description().vertex_array;
+                    vao_known = true;
+                }
+                if (!vao_known || bound_vao != vao) {
+                    glBindVertexArray(vao);
+                    pipeline_states.note_vertex_array(vao); // rest of bound state stays valid
+                    bound_vao = vao;
+                    vao_known = true;
+                }
+
+                const instanced_mesh& m = b.key.mesh;
+                const GLvoid * indices = reinterpret_cast<const GLvoid*>(uintptr_t(m.first_index) * index_size(m.type));
+                commands.draw_elements_base_instance(*m.mode, m.count, m.type, indices, GLsizei(n), m.base_vertex, base);
+                base += n;
+                counters.issued++;
+                counters.instances += n;
+            }
+
+            const GLuint issued = used;
+            lookup.clear();
+            used = 0;
+            queued = 0;
+            return issued;
+        }
+
+        // after frame draws, instance stream space is reused when GPU passed the fence
+        void end_frame() {
+            ring.fence();
+        }
+
+        instancing_stats stats() const {
+            return counters;
+        }
+
+        void reset_stats() {
+            counters = instancing_stats();
+        }
+    };
+
+};
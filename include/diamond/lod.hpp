@@ -0,0 +1,529 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "buffer.hpp"
+#include "command.hpp"
+#include "culling.hpp"
+#include "parallel.hpp"
+#include "mesh_optimizer.hpp"
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace NS_NAME {
+
+    // index range of one detail level, error is object space distance to original surface
+    struct lod_level {
+        GLuint first_index = 0;
+        GLuint index_count = 0;
+        float error = 0.f;
+    };
+
+    struct lod_chain_settings {
+        size_t max_levels = 8;          // including level 0 (source)
+        float reduction = 0.5f;         // index count ratio between levels
+        float max_error = std::numeric_limits<float>::max(); // object space limit of coarsest level
+        size_t min_triangles = 32;
+        bool optimize_cache = true;     // Tipsify order of every level
+    };
+
+    // why build_chain ended
+    enum class lod_stop : uint8_t {
+        max_levels,    // settings.max_levels reached
+        min_triangles, // next level would be under settings.min_triangles
+        stalled        // simplification made under 10% progress (max_error reached or positions that cannot move, e.g. flat shading)
+    };
+
+
+    namespace mesh_simplify {
+
+        // symmetric 4x4 plane quadric, weight is area of contributing faces
+        struct quadric {
+            double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+            double weight = 0;
+
+            static quadric plane(const glm::dvec3& n, double d, double w) {
+                quadric q;
+                q.a2 = w * n.x * n.x; q.ab = w * n.x * n.y; q.ac = w * n.x * n.z; q.ad = w * n.x * d;
+                q.b2 = w * n.y * n.y; q.bc = w * n.y * n.z; q.bd = w * n.y * d;
+                q.c2 = w * n.z * n.z; q.cd = w * n.z * d;
+                q.d2 = w * d * d;
+                return q;
+            }
+
+            quadric& operator+=(const quadric& o) {
+                a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad; b2 += o.b2; bc += o.bc; bd += o.bd;
+                c2 += o.c2; cd += o.cd; d2 += o.d2; weight += o.weight;
+                return thisref;
+            }
+
+            // weighted squared distance sum at p
+            double evaluate(const glm::dvec3& p) const {
+                const double x = p.x, y = p.y, z = p.z;
+                return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                     + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                     + c2 * z * z + 2 * cd * z + d2;
+            }
+        };
+
+        enum class vertex_kind : uint8_t { interior, border };
+
+        // quadric edge collapse (Garland, Heckbert 1997) onto existing vertices, so vertex data is shared by all levels
+        // stops at target_index_count or when next collapse exceeds target_error (object space distance)
+        // border edges are kept by plane constraints
+        // vertices sharing position (attribute seams) collapse together, each onto a wedge of target position it shares an edge with
+        // so seams stay closed, positions where that is impossible (flat shaded faces, seam corners) are kept
+        std::vector<uint32_t> simplify(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+                                       size_t target_index_count, float target_error = std::numeric_limits<float>::max(), float * result_error = nullptr) {
+            const size_t vertex_count = positions.size();
+            const size_t triangles = indices.size() / 3;
+            std::vector<uint32_t> tri(indices.begin(), indices.begin() + triangles * 3);
+            if (result_error) *result_error = 0.f;
+            if (tri.size() <= target_index_count) return tri;
+
+            // seams, wedge is circular list of vertices with equal position
+            std::vector<vertex_kind> kind(vertex_count, vertex_kind::interior);
+            std::vector<uint32_t> wedge(vertex_count);
+            std::vector<bool> seam(vertex_count, false);
+            {
+                std::unordered_multimap<uint64_t, uint32_t> first;
+                first.reserve(vertex_count);
+                for (uint32_t v = 0; v < vertex_count; v++) {
+                    wedge[v] = v;
+                    uint32_t bits[3];
+                    std::memcpy(bits, &positions[v], sizeof(bits));
+                    const uint64_t key = (uint64_t(bits[0]) * 73856093u) ^ (uint64_t(bits[1]) * 19349663u << 21) ^ (uint64_t(bits[2]) * 83492791u << 42);
+                    auto range = first.equal_range(key);
+                    bool joined = false;
+                    for (auto it = range.first; it != range.second; it++) {
+                        const uint32_t head = it->second;
+                        if (positions[head] != positions[v]) continue;
+                        wedge[v] = wedge[head];
+                        wedge[head] = v;
+                        seam[v] = seam[head] = true;
+                        joined = true;
+                        break;
+                    }
+                    if (!joined) first.emplace(key, v);
+                }
+            }
+
+            // border edges (used by one triangle)
+            auto edge_key = [](uint32_t a, uint32_t b) { return a < b ? (uint64_t(a) << 32 | b) : (uint64_t(b) << 32 | a); };
+            std::unordered_map<uint64_t, uint32_t> edge_uses;
+            edge_uses.reserve(tri.size());
+            for (size_t i = 0; i < tri.size(); i += 3) {
+                for (int k = 0; k < 3; k++) edge_uses[edge_key(tri[i + k], tri[i + (k + 1) % 3])]++;
+            }
+
+            std::vector<quadric> quadrics(vertex_count);
+            std::vector<std::vector<uint32_t>> vertex_tris(vertex_count);
+            for (size_t t = 0; t < triangles; t++) {
+                const uint32_t * v = &tri[t * 3];
+                const glm::dvec3 p0(positions[v[0]]), p1(positions[v[1]]), p2(positions[v[2]]);
+                glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+                const double len = glm::length(n);
+                if (len > 0.0) n /= len;
+                const double area = len * 0.5;
+                quadric q = quadric::plane(n, -glm::dot(n, p0), area);
+                q.weight = area;
+                for (int k = 0; k < 3; k++) {
+                    quadrics[v[k]] += q;
+                    vertex_tris[v[k]].push_back(uint32_t(t));
+                }
+                for (int k = 0; k < 3; k++) {
+                    const uint32_t a = v[k], b = v[(k + 1) % 3];
+                    if (edge_uses[edge_key(a, b)] != 1) continue;
+                    const glm::dvec3 pa(positions[a]), pb(positions[b]);
+                    const glm::dvec3 e = pb - pa;
+                    glm::dvec3 side = glm::cross(e, n);
+                    const double side_len = glm::length(side);
+                    if (side_len <= 0.0) continue;
+                    side /= side_len;
+                    quadric border = quadric::plane(side, -glm::dot(side, pa), glm::dot(e, e) * 10.0);
+                    quadrics[a] += border;
+                    quadrics[b] += border;
+                    if (kind[a] == vertex_kind::interior) kind[a] = vertex_kind::border;
+                    if (kind[b] == vertex_kind::interior) kind[b] = vertex_kind::border;
+                }
+            }
+
+            struct collapse {
+                double cost;
+                uint32_t from, to;
+                uint32_t from_version, to_version;
+                bool operator<(const collapse& o) const { return cost > o.cost; } // min heap
+            };
+            std::priority_queue<collapse> heap;
+            std::vector<uint32_t> version(vertex_count, 0);
+            std::vector<bool> removed(triangles, false), alive(vertex_count, true);
+
+            auto cost_of = [&](uint32_t from, uint32_t to) {
+                quadric q = quadrics[from];
+                q += quadrics[to];
+                return std::max(q.evaluate(glm::dvec3(positions[to])), 0.0) / std::max(q.weight, 1e-30);
+            };
+            auto allowed = [&](uint32_t from, uint32_t to) {
+                return kind[from] != vertex_kind::border || (kind[to] == vertex_kind::border && edge_uses[edge_key(from, to)] == 1);
+            };
+
+            // collapses moving from's position onto to's, one per wedge of from (false when a wedge has no partner)
+            std::vector<std::pair<uint32_t, uint32_t>> pairs;
+            auto plan = [&](uint32_t from, uint32_t to, std::vector<std::pair<uint32_t, uint32_t>>& out) {
+                out.clear();
+                if (!seam[from]) {
+                    if (!allowed(from, to)) return false;
+                    out.emplace_back(from, to);
+                    return true;
+                }
+                uint32_t w = from;
+                do {
+                    if (w == to) return false; // same position
+                    uint32_t target = UINT32_MAX;
+                    uint32_t u = to;
+                    do {
+                        auto found = edge_uses.find(edge_key(w, u));
+                        if (alive[u] && found != edge_uses.end() && found->second && allowed(w, u)) { target = u; break; }
+                        u = wedge[u];
+                    } while (u != to);
+                    if (target == UINT32_MAX) return false;
+                    out.emplace_back(w, target);
+                    w = wedge[w];
+                } while (w != from);
+                return true;
+            };
+            auto plan_cost = [&](const std::vector<std::pair<uint32_t, uint32_t>>& collapses) {
+                double cost = 0.0;
+                for (auto& c : collapses) cost += cost_of(c.first, c.second);
+                return cost;
+            };
+            auto push = [&](uint32_t from, uint32_t to) {
+                if (!plan(from, to, pairs)) return;
+                heap.push({ plan_cost(pairs), from, to, version[from], version[to] });
+            };
+            for (size_t i = 0; i < tri.size(); i += 3) {
+                for (int k = 0; k < 3; k++) {
+                    push(tri[i + k], tri[i + (k + 1) % 3]);
+                    push(tri[i + (k + 1) % 3], tri[i + k]);
+                }
+            }
+
+            // moving from onto to must not flip or collapse remaining triangles
+            auto valid = [&](uint32_t from, uint32_t to) {
+                const glm::vec3 target = positions[to];
+                for (uint32_t t : vertex_tris[from]) {
+                    if (removed[t]) continue;
+                    const uint32_t * v = &tri[t * 3];
+                    if (v[0] == to || v[1] == to || v[2] == to) continue;
+                    glm::vec3 p[3] = { positions[v[0]], positions[v[1]], positions[v[2]] };
+                    const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                    for (int k = 0; k < 3; k++) if (v[k] == from) p[k] = target;
+                    const glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                    const float la = glm::length(after), lb = glm::length(before);
+                    if (la <= 1e-12f * std::max(lb, 1e-12f) || glm::dot(before, after) <= 0.25f * la * lb) return false;
+                }
+                return true;
+            };
+
+            size_t live = triangles;
+            double max_cost = 0.0;
+            const double limit = double(target_error) * double(target_error);
+            while (live * 3 > target_index_count && !heap.empty()) {
+                const collapse c = heap.top();
+                heap.pop();
+                if (!alive[c.from] || !alive[c.to] || version[c.from] != c.from_version || version[c.to] != c.to_version) continue;
+                if (c.cost > limit) break;
+                if (!plan(c.from, c.to, pairs)) continue;
+                if (seam[c.from]) {
+                    // other wedges may have changed since queued
+                    const double cost = plan_cost(pairs);
+                    if (cost > c.cost * (1.0 + 1e-9) + 1e-30) {
+                        heap.push({ cost, c.from, c.to, c.from_version, c.to_version });
+                        continue;
+                    }
+                }
+                bool ok = true;
+                for (auto& p : pairs) ok = ok && valid(p.first, p.second);
+                if (!ok) continue;
+
+                for (auto& p : pairs) {
+                    const uint32_t from = p.first, to = p.second;
+                    for (uint32_t t : vertex_tris[from]) {
+                        if (removed[t]) continue;
+                        uint32_t * v = &tri[t * 3];
+                        if (v[0] == to || v[1] == to || v[2] == to) {
+                            removed[t] = true;
+                            live--;
+                            continue;
+                        }
+                        for (int k = 0; k < 3; k++) if (v[k] == from) v[k] = to;
+                        vertex_tris[to].push_back(t);
+                    }
+                    // border state of edges around survivor
+                    for (uint32_t t : vertex_tris[to]) {
+                        if (removed[t]) continue;
+                        const uint32_t * v = &tri[t * 3];
+                        for (int k = 0; k < 3; k++) if (v[k] != to) edge_uses[edge_key(to, v[k])] = 0;
+                    }
+                    for (uint32_t t : vertex_tris[to]) {
+                        if (removed[t]) continue;
+                        const uint32_t * v = &tri[t * 3];
+                        for (int k = 0; k < 3; k++) if (v[k] != to) edge_uses[edge_key(to, v[k])]++;
+                    }
+                    quadrics[to] += quadrics[from];
+                    alive[from] = false;
+                    vertex_tris[from].clear();
+                    version[to]++;
+                }
+                max_cost = std::max(max_cost, c.cost);
+
+                // compact and requeue edges around survivors
+                for (auto& p : pairs) {
+                    const uint32_t to = p.second;
+                    auto& around = vertex_tris[to];
+                    around.erase(std::remove_if(around.begin(), around.end(), [&](uint32_t t) { return removed[t]; }), around.end());
+                    for (uint32_t t : around) {
+                        const uint32_t * v = &tri[t * 3];
+                        for (int k = 0; k < 3; k++) {
+                            if (v[k] == to) continue;
+                            push(to, v[k]);
+                            push(v[k], to);
+                        }
+                    }
+                }
+            }
+
+            std::vector<uint32_t> result;
+            result.reserve(live * 3);
+            for (size_t t = 0; t < triangles; t++) {
+                if (!removed[t]) result.insert(result.end(), tri.begin() + t * 3, tri.begin() + t * 3 + 3);
+            }
+            if (result_error) *result_error = float(std::sqrt(max_cost));
+            return result;
+        }
+
+        // level 0 is source, every level is simplified from previous one, indices are appended to out_indices
+        std::vector<lod_level> build_chain(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+                                           std::vector<uint32_t>& out_indices, const lod_chain_settings& settings = lod_chain_settings(), lod_stop * stop = nullptr) {
+            std::vector<lod_level> levels;
+            std::vector<uint32_t> current = indices;
+            float error = 0.f;
+            if (stop) *stop = lod_stop::max_levels;
+            while (levels.size() < std::max(settings.max_levels, size_t(1))) {
+                if (settings.optimize_cache) current = mesh_optimize::optimize_vertex_cache(current, positions.size());
+                lod_level level;
+                level.first_index = GLuint(out_indices.size());
+                level.index_count = GLuint(current.size());
+                level.error = error;
+                out_indices.insert(out_indices.end(), current.begin(), current.end());
+                levels.push_back(level);
+
+                const size_t target = size_t(double(current.size() / 3) * settings.reduction) * 3;
+                if (target < settings.min_triangles * 3) {
+                    if (stop) *stop = lod_stop::min_triangles;
+                    break;
+                }
+                float step_error = 0.f;
+                std::vector<uint32_t> next = simplify(current, positions, target, settings.max_error - error, &step_error);
+                if (next.empty() || next.size() * 10 > current.size() * 9) { // under 10% progress
+                    if (stop) *stop = lod_stop::stalled;
+                    break;
+                }
+                error += step_error; // conservative bound against source
+                current.swap(next);
+            }
+            return levels;
+        }
+    };
+
+
+    struct lod_mesh {
+        GLint base_vertex = 0;
+        glm::vec4 sphere = glm::vec4(0.f); // object space center, radius
+        std::vector<lod_level> levels;
+        lod_stop stop = lod_stop::max_levels; // stalled means chain is shorter than settings asked for
+    };
+
+
+    // shared vertex and index buffers holding LOD chains of many meshes (one vertex layout, 32-bit indices)
+    class lod_arena {
+    protected:
+        buffer vertex_buf;
+        buffer index_buf;
+        GLuint stride;
+        GLuint vertex_capacity;
+        GLuint index_capacity;
+        GLuint vertex_used = 0;
+        GLuint index_used = 0;
+        std::vector<lod_mesh> mesh_list;
+
+    public:
+        lod_arena(GLuint vertex_size, GLuint vertex_capacity, GLuint index_capacity)
+            : stride(vertex_size), vertex_capacity(vertex_capacity), index_capacity(index_capacity) {
+            vertex_buf.storage(GLsizeiptr(vertex_size) * vertex_capacity);
+            index_buf.storage(GLsizeiptr(index_capacity) * 4);
+        }
+
+        // vertices are vertex_count * vertex_size bytes, positions are their object space positions
+        // returns mesh id, UINT32_MAX when arena is full
+        GLuint add(const void * vertices, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const lod_chain_settings& settings = lod_chain_settings()) {
+            const GLuint vertex_count = GLuint(positions.size());
+            std::vector<uint32_t> chain;
+            lod_mesh mesh;
+            mesh.levels = mesh_simplify::build_chain(indices, positions, chain, settings, &mesh.stop);
+            if (vertex_used + vertex_count > vertex_capacity) return UINT32_MAX;
+            if (index_used + chain.size() > index_capacity) return UINT32_MAX;
+
+            glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+            for (auto& p : positions) { lo = glm::min(lo, p); hi = glm::max(hi, p); }
+            const glm::vec3 center = vertex_count ? (lo + hi) * 0.5f : glm::vec3(0.f);
+            float radius = 0.f;
+            for (auto& p : positions) radius = std::max(radius, glm::length(p - center));
+            mesh.sphere = glm::vec4(center, radius);
+
+            mesh.base_vertex = GLint(vertex_used);
+            for (auto& level : mesh.levels) level.first_index += index_used;
+            vertex_buf.subdata(GLintptr(vertex_used) * stride, GLsizei(vertex_count * stride), vertices);
+            index_buf.subdata(GLintptr(index_used) * 4, GLsizei(chain.size() * 4), chain.data());
+            vertex_used += vertex_count;
+            index_used += GLuint(chain.size());
+            mesh_list.push_back(std::move(mesh));
+            return GLuint(mesh_list.size() - 1);
+        }
+
+        const lod_mesh& mesh(GLuint id) const {
+            return mesh_list[id];
+        }
+
+        size_t mesh_count() const {
+            return mesh_list.size();
+        }
+
+        // bind as vertex buffer (with stride) and element buffer
+        buffer& vertices() {
+            return vertex_buf;
+        }
+
+        buffer& indices() {
+            return index_buf;
+        }
+
+        GLuint vertex_size() const {
+            return stride;
+        }
+
+        GLuint used_vertices() const {
+            return vertex_used;
+        }
+
+        GLuint used_indices() const {
+            return index_used;
+        }
+    };
+
+
+    // per scene screen space error settings
+    struct lod_thresholds {
+        float pixel_error = 1.f;  // max projected error
+        float hysteresis = 0.2f;  // coarser level needs error under pixel_error * (1 - hysteresis)
+        GLuint min_level = 0;
+        GLuint max_level = UINT32_MAX;
+    };
+
+    struct lod_instance {
+        glm::vec4 sphere = glm::vec4(0.f); // world bounds (center, radius)
+        float scale = 1.f;                 // largest axis scale of object to world
+        GLuint mesh = 0;
+        GLuint instance_id = 0;              // written as base instance
+        GLuint level = 0;                    // selected level (kept for hysteresis)
+    };
+
+
+    // picks level per instance by projected error and writes index range of indirect draws
+    class lod_selector {
+    protected:
+        lod_thresholds limits;
+        glm::vec3 camera = glm::vec3(0.f);
+        float projection = 1.f; // pixels per unit at distance 1
+
+        GLuint choose(const lod_mesh& mesh, const lod_instance& inst) const {
+            const float distance = std::max(glm::length(glm::vec3(inst.sphere) - camera) - inst.sphere.w, 1e-4f);
+            const float pixels_per_error = inst.scale * projection / distance;
+            const GLuint last = GLuint(mesh.levels.size()) - 1;
+            GLuint level = 0;
+            for (GLuint l = last; l > 0; l--) {
+                float allowed = limits.pixel_error;
+                if (l > inst.level) allowed *= 1.f - limits.hysteresis;
+                if (mesh.levels[l].error * pixels_per_error <= allowed) { level = l; break; }
+            }
+            return std::min(std::max(level, std::min(limits.min_level, last)), std::min(limits.max_level, last));
+        }
+
+    public:
+        lod_selector(const lod_thresholds& thresholds = lod_thresholds()) : limits(thresholds) {}
+
+        void set_thresholds(const lod_thresholds& thresholds) {
+            limits = thresholds;
+        }
+
+        const lod_thresholds& thresholds() const {
+            return limits;
+        }
+
+        // proj is projection matrix, viewport_height in pixels
+        void set_view(const glm::vec3& camera_position, const glm::mat4& proj, float viewport_height) {
+            camera = camera_position;
+            projection = std::abs(proj[1][1]) * viewport_height * 0.5f;
+        }
+
+        // one command per instance, returns submitted index count
+        uint64_t select(const lod_arena& arena, lod_instance * instances, size_t count, draw_elements_indirect_command * out) {
+            std::atomic<uint64_t> total{ 0 };
+            default_pool().parallel_for(0, count, 1024, [&](size_t begin, size_t end) {
+                uint64_t sum = 0;
+                for (size_t i = begin; i < end; i++) {
+                    const lod_mesh& mesh = arena.mesh(instances[i].mesh);
+                    const GLuint level = choose(mesh, instances[i]);
+                    instances[i].level = level;
+                    draw_elements_indirect_command& cmd = out[i];
+                    cmd.count = mesh.levels[level].index_count;
+                    cmd.instance_count = 1;
+                    cmd.first_index = mesh.levels[level].first_index;
+                    cmd.base_vertex = mesh.base_vertex;
+                    cmd.base_instance = instances[i].instance_id;
+                    sum += cmd.count;
+                }
+                total += sum;
+            });
+            return total.load();
+        }
+
+        // fills gpu_culler input with selected index ranges
+        uint64_t select(const lod_arena& arena, lod_instance * instances, size_t count, instance_bounds * out) {
+            std::atomic<uint64_t> total{ 0 };
+            default_pool().parallel_for(0, count, 1024, [&](size_t begin, size_t end) {
+                uint64_t sum = 0;
+                for (size_t i = begin; i < end; i++) {
+                    const lod_mesh& mesh = arena.mesh(instances[i].mesh);
+                    const GLuint level = choose(mesh, instances[i]);
+                    instances[i].level = level;
+                    out[i].sphere = instances[i].sphere;
+                    out[i].index_count = mesh.levels[level].index_count;
+                    out[i].first_index = mesh.levels[level].first_index;
+                    out[i].base_vertex = mesh.base_vertex;
+                    out[i].instance_id = instances[i].instance_id;
+                    sum += out[i].index_count;
+                }
+                total += sum;
+            });
+            return total.load();
+        }
+    };
+
+};
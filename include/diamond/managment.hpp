@@ -3,6 +3,7 @@
 #include "opengl.hpp"
 #include "program.hpp"
 #include "vertex_array.hpp"
+#include "framebuffer.hpp"
 
 namespace NS_NAME {
 
@@ -19,6 +20,10 @@ namespace NS_NAME {
         void bind_vertex_array(vertex_array& vao) {
             glBindVertexArray((GLuint)vao);
         }
+
+        void bind_framebuffer(framebuffer& fbo, GLenum target = GL_FRAMEBUFFER) {
+            glBindFramebuffer(target, (GLuint)fbo);
+        }
     };
 
     _managment managment;
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "opengl.hpp"
+#include <string>
+#include <cstdint>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace NS_NAME {
+
+    // read-only file mapping, data stays valid while object lives
+    class mapped_file {
+    protected:
+        const uint8_t * ptr = nullptr;
+        size_t length = 0;
+
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#else
+        int file = -1;
+#endif
+
+    public:
+        mapped_file() {}
+        mapped_file(const std::string& path) { this->open(path); }
+        mapped_file(const mapped_file& another) = delete;
+        mapped_file(mapped_file&& another) { thisref = std::move(another); }
+        ~mapped_file() { this->close(); }
+
+        mapped_file& operator=(const mapped_file& another) = delete;
+        mapped_file& operator=(mapped_file&& another) {
+            if (this == &another) return thisref;
+            this->close();
+            std::swap(ptr, another.ptr);
+            std::swap(length, another.length);
+            std::swap(file, another.file);
+#ifdef _WIN32
+            std::swap(mapping, another.mapping);
+#endif
+            return thisref;
+        }
+
+        bool open(const std::string& path) {
+            this->close();
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE) return false;
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) { this->close(); return false; }
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping) { this->close(); return false; }
+            ptr = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            length = size_t(size.QuadPart);
+#else
+            file = ::open(path.c_str(), O_RDONLY);
+            if (file < 0) return false;
+            struct stat st;
+            if (fstat(file, &st) != 0 || st.st_size == 0) { this->close(); return false; }
+            void * view = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (view == MAP_FAILED) { this->close(); return false; }
+            ptr = (const uint8_t *)view;
+            length = size_t(st.st_size);
+#endif
+            if (!ptr) { this->close(); return false; }
+            return true;
+        }
+
+        void close() {
+#ifdef _WIN32
+            if (ptr) UnmapViewOfFile(ptr);
+            if (mapping) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+            mapping = nullptr;
+            file = INVALID_HANDLE_VALUE;
+#else
+            if (ptr) munmap((void *)ptr, length);
+            if (file >= 0) ::close(file);
+            file = -1;
+#endif
+            ptr = nullptr;
+            length = 0;
+        }
+
+        bool is_open() const {
+            return ptr != nullptr;
+        }
+
+        const uint8_t * data() const {
+            return ptr;
+        }
+
+        size_t size() const {
+            return length;
+        }
+
+        // range fully inside of mapping
+        bool contains(uint64_t offset, uint64_t bytes) const {
+            return offset <= length && bytes <= length - offset;
+        }
+    };
+
+};
@@ -0,0 +1,342 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "buffer.hpp"
+#include "vertex_array.hpp"
+#include "glm/gtc/packing.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+namespace NS_NAME {
+
+    // post-transform cache efficiency of triangle list
+    struct vertex_cache_stats {
+        double acmr = 0.0; // vertex shader invocations per triangle (0.5 .. 3)
+        double atvr = 0.0; // invocations per unique vertex (1 is optimal)
+    };
+
+    // result of narrow_indices
+    struct index_data {
+        GLenum type = GL_UNSIGNED_INT;
+        std::vector<uint8_t> bytes;
+
+        GLsizei count() const {
+            return GLsizei(bytes.size() / (type == GL_UNSIGNED_SHORT ? 2 : 4));
+        }
+    };
+
+    // 16 bytes: half position, octahedral snorm16 normal, unorm16 texcoord
+    struct quantized_vertex {
+        uint16_t position[4];
+        int16_t normal[2];
+        uint16_t texcoord[2];
+    };
+
+    // texcoord = unorm * uv_scale + uv_offset
+    struct quantized_mesh {
+        std::vector<quantized_vertex> vertices;
+        glm::vec2 uv_offset = glm::vec2(0.f);
+        glm::vec2 uv_scale = glm::vec2(1.f);
+    };
+
+    struct mesh_optimize_report {
+        vertex_cache_stats before;
+        vertex_cache_stats after;
+        double bytes_per_vertex_before = 0.0; // vertex and index bytes per unique vertex
+        double bytes_per_vertex_after = 0.0;
+        size_t clusters = 0;
+    };
+
+
+    namespace mesh_optimize {
+
+        // FIFO cache simulation
+        vertex_cache_stats analyze_vertex_cache(const std::vector<uint32_t>& indices, size_t vertex_count, size_t cache_size = 16) {
+            vertex_cache_stats stats;
+            if (indices.empty()) return stats;
+            std::vector<uint32_t> stamp(vertex_count, 0);
+            std::vector<bool> seen(vertex_count, false);
+            uint32_t time = uint32_t(cache_size) + 1;
+            size_t misses = 0, unique = 0;
+            for (uint32_t v : indices) {
+                if (!seen[v]) { seen[v] = true; unique++; }
+                if (time - stamp[v] > cache_size) {
+                    stamp[v] = time++;
+                    misses++;
+                }
+            }
+            stats.acmr = double(misses) / double(indices.size() / 3);
+            stats.atvr = unique ? double(misses) / double(unique) : 0.0;
+            return stats;
+        }
+
+        // Tipsify (Sander, Nehab, Barczak 2007), linear time vertex cache ordering
+        std::vector<uint32_t> optimize_vertex_cache(const std::vector<uint32_t>& indices, size_t vertex_count, size_t cache_size = 16) {
+            const size_t triangles = indices.size() / 3;
+            std::vector<uint32_t> offsets(vertex_count + 1, 0), adjacency(indices.size());
+            std::vector<int32_t> live(vertex_count, 0);
+            for (uint32_t v : indices) live[v]++;
+            for (size_t v = 0; v < vertex_count; v++) offsets[v + 1] = offsets[v] + uint32_t(live[v]);
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t t = 0; t < triangles; t++) {
+                for (int k = 0; k < 3; k++) adjacency[fill[indices[t * 3 + k]]++] = uint32_t(t);
+            }
+
+            std::vector<uint32_t> stamp(vertex_count, 0), dead_end, candidates, result;
+            std::vector<bool> emitted(triangles, false);
+            result.reserve(indices.size());
+            uint32_t time = uint32_t(cache_size) + 1;
+            size_t cursor = 0;
+            int64_t fan = vertex_count ? 0 : -1;
+
+            while (fan >= 0) {
+                candidates.clear();
+                for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; a++) {
+                    const uint32_t t = adjacency[a];
+                    if (emitted[t]) continue;
+                    for (int k = 0; k < 3; k++) {
+                        const uint32_t v = indices[t * 3 + k];
+                        result.push_back(v);
+                        dead_end.push_back(v);
+                        candidates.push_back(v);
+                        live[v]--;
+                        if (time - stamp[v] > cache_size) stamp[v] = time++;
+                    }
+                    emitted[t] = true;
+                }
+
+                // prefer candidates still in cache after their remaining triangles are emitted
+                int64_t best = -1, priority = -1;
+                for (uint32_t v : candidates) {
+                    if (live[v] <= 0) continue;
+                    int64_t p = 0;
+                    if (int64_t(time - stamp[v]) + 2 * live[v] <= int64_t(cache_size)) p = time - stamp[v];
+                    if (p > priority) { priority = p; best = v; }
+                }
+                if (best < 0) {
+                    while (!dead_end.empty() && best < 0) {
+                        const uint32_t v = dead_end.back();
+                        dead_end.pop_back();
+                        if (live[v] > 0) best = v;
+                    }
+                    while (best < 0 && cursor < vertex_count) {
+                        if (live[cursor] > 0) best = int64_t(cursor);
+                        cursor++;
+                    }
+                }
+                fan = best;
+            }
+            return result;
+        }
+
+        // splits cache ordered list into clusters (where local ACMR drops below threshold * ACMR)
+        // and sorts them outward facing first, so front geometry tends to be drawn first
+        std::vector<uint32_t> optimize_overdraw(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, size_t cache_size = 16, double threshold = 1.05, size_t * cluster_count = nullptr) {
+            const size_t triangles = indices.size() / 3;
+            const double acmr = analyze_vertex_cache(indices, positions.size(), cache_size).acmr;
+
+            std::vector<size_t> starts = { 0 };
+            std::vector<uint32_t> stamp(positions.size(), 0);
+            uint32_t time = uint32_t(cache_size) + 1;
+            size_t misses = 0;
+            for (size_t t = 0; t < triangles; t++) {
+                for (int k = 0; k < 3; k++) {
+                    const uint32_t v = indices[t * 3 + k];
+                    if (time - stamp[v] > cache_size) { stamp[v] = time++; misses++; }
+                }
+                const size_t length = t + 1 - starts.back();
+                if (length >= 8 && t + 1 < triangles && double(misses) / double(length) <= acmr * threshold) {
+                    starts.push_back(t + 1);
+                    misses = 0;
+                    time += uint32_t(cache_size) + 1; // cache flush at boundary
+                }
+            }
+            starts.push_back(triangles);
+
+            glm::dvec3 mesh_center(0.0);
+            double mesh_area = 0.0;
+            struct cluster { size_t begin, end; double key; };
+            std::vector<cluster> clusters;
+            std::vector<glm::dvec3> centers;
+            std::vector<glm::dvec3> normals;
+            for (size_t c = 0; c + 1 < starts.size(); c++) {
+                glm::dvec3 center(0.0), normal(0.0);
+                double area = 0.0;
+                for (size_t t = starts[c]; t < starts[c + 1]; t++) {
+                    const glm::dvec3 a(positions[indices[t * 3]]), b(positions[indices[t * 3 + 1]]), d(positions[indices[t * 3 + 2]]);
+                    const glm::dvec3 n = glm::cross(b - a, d - a);
+                    const double w = glm::length(n) * 0.5;
+                    center += (a + b + d) * (w / 3.0);
+                    normal += n;
+                    area += w;
+                }
+                mesh_center += center;
+                mesh_area += area;
+                centers.push_back(area > 0.0 ? center / area : center);
+                normals.push_back(glm::length(normal) > 0.0 ? glm::normalize(normal) : normal);
+                clusters.push_back({ starts[c], starts[c + 1], 0.0 });
+            }
+            if (mesh_area > 0.0) mesh_center /= mesh_area;
+            for (size_t c = 0; c < clusters.size(); c++) clusters[c].key = glm::dot(centers[c] - mesh_center, normals[c]);
+            std::stable_sort(clusters.begin(), clusters.end(), [](const cluster& a, const cluster& b) { return a.key > b.key; });
+
+            std::vector<uint32_t> result;
+            result.reserve(indices.size());
+            for (auto& c : clusters) result.insert(result.end(), indices.begin() + c.begin * 3, indices.begin() + c.end * 3);
+            if (cluster_count) *cluster_count = clusters.size();
+            return result;
+        }
+
+        // vertices in first use order (unreferenced dropped), indices rewritten; returns vertex count
+        size_t optimize_vertex_fetch(std::vector<uint32_t>& indices, std::vector<uint8_t>& vertices, size_t vertex_size) {
+            const size_t vertex_count = vertices.size() / vertex_size;
+            std::vector<uint32_t> remap(vertex_count, UINT32_MAX);
+            std::vector<uint8_t> result;
+            result.reserve(vertices.size());
+            uint32_t next = 0;
+            for (uint32_t& v : indices) {
+                if (remap[v] == UINT32_MAX) {
+                    remap[v] = next++;
+                    result.insert(result.end(), vertices.begin() + v * vertex_size, vertices.begin() + (v + 1) * vertex_size);
+                }
+                v = remap[v];
+            }
+            vertices.swap(result);
+            return next;
+        }
+
+        // typed form of optimize_vertex_fetch
+        template<class V>
+        size_t optimize_vertex_fetch(std::vector<uint32_t>& indices, std::vector<V>& vertices) {
+            std::vector<uint8_t> bytes(vertices.size() * sizeof(V));
+            std::memcpy(bytes.data(), vertices.data(), bytes.size());
+            const size_t count = optimize_vertex_fetch(indices, bytes, sizeof(V));
+            vertices.resize(count);
+            std::memcpy(vertices.data(), bytes.data(), bytes.size());
+            return count;
+        }
+
+        // 16-bit indices when every vertex fits (primitive restart index is avoided)
+        index_data narrow_indices(const std::vector<uint32_t>& indices, size_t vertex_count) {
+            index_data out;
+            if (vertex_count < 0xFFFF) {
+                out.type = GL_UNSIGNED_SHORT;
+                out.bytes.resize(indices.size() * 2);
+                uint16_t * dst = (uint16_t *)out.bytes.data();
+                for (size_t i = 0; i < indices.size(); i++) dst[i] = uint16_t(indices[i]);
+            } else {
+                out.type = GL_UNSIGNED_INT;
+                out.bytes.resize(indices.size() * 4);
+                std::memcpy(out.bytes.data(), indices.data(), out.bytes.size());
+            }
+            return out;
+        }
+
+        // unit vector to [-1, 1]^2 octahedral map
+        glm::vec2 octahedral_encode(glm::vec3 n) {
+            n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+            glm::vec2 p(n.x, n.y);
+            if (n.z < 0.f) {
+                p = (1.f - glm::abs(glm::vec2(n.y, n.x))) * glm::vec2(p.x >= 0.f ? 1.f : -1.f, p.y >= 0.f ? 1.f : -1.f);
+            }
+            return p;
+        }
+
+        glm::vec3 octahedral_decode(glm::vec2 p) {
+            glm::vec3 n(p.x, p.y, 1.f - std::abs(p.x) - std::abs(p.y));
+            const float t = std::max(-n.z, 0.f);
+            n.x += n.x >= 0.f ? -t : t;
+            n.y += n.y >= 0.f ? -t : t;
+            return glm::normalize(n);
+        }
+
+        // GLSL counterpart of octahedral_decode for quantized normals
+        const char * octahedral_decode_glsl = R"(
+vec3 octahedral_decode(vec2 p) {
+    vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+)";
+
+        // normals and texcoords may be empty
+        quantized_mesh quantize(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& texcoords) {
+            quantized_mesh out;
+            glm::vec2 lo(0.f), hi(1.f);
+            if (!texcoords.empty()) {
+                lo = hi = texcoords[0];
+                for (auto& uv : texcoords) { lo = glm::min(lo, uv); hi = glm::max(hi, uv); }
+            }
+            out.uv_offset = lo;
+            out.uv_scale = glm::max(hi - lo, glm::vec2(1e-8f));
+
+            out.vertices.resize(positions.size());
+            for (size_t i = 0; i < positions.size(); i++) {
+                quantized_vertex& q = out.vertices[i];
+                for (int k = 0; k < 3; k++) q.position[k] = glm::packHalf1x16(positions[i][k]);
+                q.position[3] = glm::packHalf1x16(1.f);
+
+                const glm::vec2 oct = i < normals.size() ? octahedral_encode(normals[i]) : glm::vec2(0.f);
+                q.normal[0] = int16_t(glm::packSnorm1x16(oct.x));
+                q.normal[1] = int16_t(glm::packSnorm1x16(oct.y));
+
+                const glm::vec2 uv = i < texcoords.size() ? (texcoords[i] - out.uv_offset) / out.uv_scale : glm::vec2(0.f);
+                q.texcoord[0] = glm::packUnorm1x16(uv.x);
+                q.texcoord[1] = glm::packUnorm1x16(uv.y);
+            }
+            return out;
+        }
+
+        // attribute formats of quantized_vertex (position, normal, texcoord locations) on one binding
+        void setup_quantized_attributes(vertex_array& vao, GLuint binding, buffer& vertices, GLintptr offset = 0, GLuint position = 0, GLuint normal = 1, GLuint texcoord = 2) {
+            vao.vertex_buffer(binding, vertices, offset, sizeof(quantized_vertex));
+            auto pos = vao.create_attribute(position);
+            pos.attrib_format(3, GL_HALF_FLOAT, GL_FALSE, offsetof(quantized_vertex, position));
+            pos.binding(binding);
+            auto nrm = vao.create_attribute(normal);
+            nrm.attrib_format(2, GL_SHORT, GL_TRUE, offsetof(quantized_vertex, normal));
+            nrm.binding(binding);
+            auto uv = vao.create_attribute(texcoord);
+            uv.attrib_format(2, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(quantized_vertex, texcoord));
+            uv.binding(binding);
+        }
+
+        // full pipeline over float position/normal/texcoord mesh: cache, overdraw, fetch, quantize, narrow
+        mesh_optimize_report optimize(std::vector<uint32_t>& indices, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<glm::vec2>& texcoords,
+                                      quantized_mesh& out_vertices, index_data& out_indices, size_t cache_size = 16, double overdraw_threshold = 1.05) {
+            mesh_optimize_report report;
+            const size_t float_size = sizeof(glm::vec3) + (normals.empty() ? 0 : sizeof(glm::vec3)) + (texcoords.empty() ? 0 : sizeof(glm::vec2));
+            report.before = analyze_vertex_cache(indices, positions.size(), cache_size);
+            report.bytes_per_vertex_before = positions.empty() ? 0.0 : double(positions.size() * float_size + indices.size() * 4) / double(positions.size());
+
+            indices = optimize_vertex_cache(indices, positions.size(), cache_size);
+            indices = optimize_overdraw(indices, positions, cache_size, overdraw_threshold, &report.clusters);
+
+            // remap all streams with one permutation
+            std::vector<uint32_t> order(positions.size());
+            for (size_t i = 0; i < order.size(); i++) order[i] = uint32_t(i);
+            const size_t count = optimize_vertex_fetch(indices, order);
+            auto gather = [&](auto& stream) {
+                if (stream.empty()) return;
+                auto copy = stream;
+                stream.resize(count);
+                for (size_t i = 0; i < count; i++) stream[i] = copy[order[i]];
+            };
+            gather(positions);
+            gather(normals);
+            gather(texcoords);
+
+            out_vertices = quantize(positions, normals, texcoords);
+            out_indices = narrow_indices(indices, count);
+            report.after = analyze_vertex_cache(indices, count, cache_size);
+            report.bytes_per_vertex_after = count ? double(count * sizeof(quantized_vertex) + out_indices.bytes.size()) / double(count) : 0.0;
+            return report;
+        }
+    };
+
+};
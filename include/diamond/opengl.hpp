@@ -8,12 +8,314 @@
 
 #include "glm/glm.hpp"
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <type_traits>
+#include <cstdint>
+#include <algorithm>
 
 #define thisref (*this)
 #define NS_NAME dgl
 
 namespace NS_NAME {
 
+    // builders with batched release (static void release_n(GLsizei, const GLuint *)) may be deleted deferred
+    template<class B, class = void>
+    struct has_release_n : std::false_type {};
+
+    template<class B>
+    struct has_release_n<B, std::void_t<decltype(B::release_n(GLsizei(0), (const GLuint *)nullptr))>> : std::true_type {};
+
+
+    class deletion_queue_base {
+    public:
+        virtual void seal(uint64_t frame) = 0;
+        virtual size_t collect(uint64_t completed_frame) = 0;
+        virtual size_t pending() = 0;
+    };
+
+
+    // names dropped in frames, released by frame boundary on GL thread
+    class _deferred_deletion {
+    protected:
+        std::mutex mtx;
+        std::vector<deletion_queue_base *> queues;
+        std::deque<std::pair<uint64_t, GLsync>> fences;
+        std::atomic<bool> active{ false };
+        uint64_t frame = 0;
+        uint64_t released = 0;
+
+    public:
+        void register_queue(deletion_queue_base * queue) {
+            std::lock_guard<std::mutex> lock(mtx);
+            queues.push_back(queue);
+        }
+
+        // destructors of objects with batched release enqueue names (from any thread)
+        void enable(bool on = true) {
+            active = on;
+        }
+
+        bool enabled() const {
+            return active;
+        }
+
+        // GL thread, after frame commands: names dropped since last boundary wait for this frame fence,
+        // names of frames whose fence signaled are released in batches (returns released count)
+        size_t frame_boundary() {
+            std::lock_guard<std::mutex> lock(mtx);
+            frame++;
+            for (auto q : queues) q->seal(frame);
+            fences.emplace_back(frame, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+            uint64_t completed = 0;
+            while (!fences.empty()) {
+                const GLenum state = glClientWaitSync(fences.front().second, 0, 0);
+                if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED) break;
+                completed = fences.front().first;
+                glDeleteSync(fences.front().second);
+                fences.pop_front();
+            }
+            size_t count = 0;
+            if (completed) for (auto q : queues) count += q->collect(completed);
+            released += count;
+            return count;
+        }
+
+        // GL thread, shutdown: waits for GPU and releases everything
+        size_t flush() {
+            std::lock_guard<std::mutex> lock(mtx);
+            frame++;
+            for (auto q : queues) q->seal(frame);
+            glFinish();
+            for (auto& f : fences) glDeleteSync(f.second);
+            fences.clear();
+            size_t count = 0;
+            for (auto q : queues) count += q->collect(frame);
+            released += count;
+            return count;
+        }
+
+        size_t pending() {
+            std::lock_guard<std::mutex> lock(mtx);
+            size_t count = 0;
+            for (auto q : queues) count += q->pending();
+            return count;
+        }
+
+        uint64_t released_count() const {
+            return released;
+        }
+    };
+
+    _deferred_deletion deferred_deletion;
+
+
+    // per builder type queue
+    template<class B>
+    class deletion_queue : public deletion_queue_base {
+    protected:
+        std::mutex mtx;
+        std::vector<GLuint> incoming;
+        std::deque<std::pair<uint64_t, std::vector<GLuint>>> sealed;
+
+        deletion_queue() {
+            deferred_deletion.register_queue(this);
+        }
+
+    public:
+        static deletion_queue& get() {
+            static deletion_queue queue;
+            return queue;
+        }
+
+        void push(GLuint name) {
+            std::lock_guard<std::mutex> lock(mtx);
+            incoming.push_back(name);
+        }
+
+        void seal(uint64_t frame) override {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (incoming.empty()) return;
+            sealed.emplace_back(frame, std::move(incoming));
+            incoming.clear();
+        }
+
+        size_t collect(uint64_t completed_frame) override {
+            std::vector<GLuint> names;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                while (!sealed.empty() && sealed.front().first <= completed_frame) {
+                    names.insert(names.end(), sealed.front().second.begin(), sealed.front().second.end());
+                    sealed.pop_front();
+                }
+            }
+            if (!names.empty()) B::release_n(GLsizei(names.size()), names.data());
+            return names.size();
+        }
+
+        size_t pending() override {
+            std::lock_guard<std::mutex> lock(mtx);
+            size_t count = incoming.size();
+            for (auto& batch : sealed) count += batch.second.size();
+            return count;
+        }
+    };
+
+
+    class name_pool_base {
+    public:
+        virtual size_t refill(size_t block, size_t low_water) = 0;
+        virtual size_t available() = 0;
+    };
+
+
+    struct name_pool_stats {
+        uint64_t served = 0;  // names taken from pools
+        uint64_t misses = 0;  // created one by one (pool empty)
+        uint64_t created = 0; // names created in blocks
+        size_t available = 0;
+    };
+
+
+    // names created in blocks ahead of constructors, refilled at frame boundary on GL thread
+    class _name_pools {
+    protected:
+        std::mutex mtx;
+        std::vector<name_pool_base *> pools;
+        std::atomic<bool> active{ false };
+        size_t block = 256;
+        size_t low_water = 64;
+
+    public:
+        std::atomic<uint64_t> served{ 0 };
+        std::atomic<uint64_t> misses{ 0 };
+        std::atomic<uint64_t> created{ 0 };
+
+        void register_pool(name_pool_base * pool) {
+            std::lock_guard<std::mutex> lock(mtx);
+            pools.push_back(pool);
+        }
+
+        // pools refill to block names when under low_water
+        void enable(size_t block_size = 256, size_t low_water_mark = 64) {
+            block = block_size;
+            low_water = std::min(low_water_mark, block_size);
+            active = true;
+        }
+
+        void disable() {
+            active = false;
+        }
+
+        bool enabled() const {
+            return active;
+        }
+
+        // GL thread (frame boundary, loading screen), returns created names
+        size_t refill() {
+            std::lock_guard<std::mutex> lock(mtx);
+            size_t count = 0;
+            for (auto p : pools) count += p->refill(block, low_water);
+            created += count;
+            return count;
+        }
+
+        name_pool_stats stats() {
+            std::lock_guard<std::mutex> lock(mtx);
+            name_pool_stats st;
+            st.served = served;
+            st.misses = misses;
+            st.created = created;
+            for (auto p : pools) st.available += p->available();
+            return st;
+        }
+    };
+
+    _name_pools name_pools;
+
+
+    // per builder type, per target (texture) stacks of created names
+    // builders provide static void create_n(GLsizei n, GLuint * heap, GLenum target)
+    // only shareable objects are pooled (buffers, textures, samplers), names taken on another context must be in its share group
+    template<class B>
+    class name_pool : public name_pool_base {
+    protected:
+        std::mutex mtx;
+        std::vector<std::pair<GLenum, std::vector<GLuint>>> targets; // few targets, linear search
+
+        name_pool() {
+            name_pools.register_pool(this);
+        }
+
+        std::vector<GLuint>& names(GLenum target) {
+            for (auto& t : targets) if (t.first == target) return t.second;
+            targets.emplace_back(target, std::vector<GLuint>());
+            return targets.back().second;
+        }
+
+    public:
+        static name_pool& get() {
+            static name_pool pool;
+            return pool;
+        }
+
+        // O(1), false when empty (target gets a block on next refill)
+        bool take(GLuint * heap, GLenum target = 0) {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto& stack = names(target);
+            if (stack.empty()) {
+                name_pools.misses++;
+                return false;
+            }
+            *heap = stack.back();
+            stack.pop_back();
+            name_pools.served++;
+            return true;
+        }
+
+        // GL thread, prewarm before burst (level streaming)
+        void reserve(size_t count, GLenum target = 0) {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto& stack = names(target);
+            if (stack.size() >= count) return;
+            const size_t old = stack.size();
+            stack.resize(count);
+            B::create_n(GLsizei(count - old), stack.data() + old, target);
+            name_pools.created += count - old;
+        }
+
+        size_t refill(size_t block, size_t low_water) override {
+            std::lock_guard<std::mutex> lock(mtx);
+            size_t count = 0;
+            for (auto& t : targets) {
+                auto& stack = t.second;
+                if (stack.size() >= low_water) continue;
+                const size_t old = stack.size();
+                stack.resize(block);
+                B::create_n(GLsizei(block - old), stack.data() + old, t.first);
+                count += block - old;
+            }
+            return count;
+        }
+
+        size_t available() override {
+            std::lock_guard<std::mutex> lock(mtx);
+            size_t count = 0;
+            for (auto& t : targets) count += t.second.size();
+            return count;
+        }
+    };
+
+    // constructor path of pooled builders
+    template<class B>
+    bool take_pooled_name(GLuint * heap, GLenum target = 0) {
+        return name_pools.enabled() && name_pool<B>::get().take(heap, target);
+    }
+
 
     template<class GL_OBJ>
     class gl_object {
@@ -62,7 +364,14 @@ namespace NS_NAME {
 
         // destructor
         ~gl_object(){
-            if (globj && globj.use_count() <= 1) GL_OBJ::release(globj.get());
+            if (!globj || globj.use_count() > 1) return;
+            if constexpr (has_release_n<GL_OBJ>::value) {
+                if (deferred_deletion.enabled()) {
+                    deletion_queue<GL_OBJ>::get().push(*globj);
+                    return;
+                }
+            }
+            GL_OBJ::release(globj.get());
         }
 
         operator const GLuint&() const { return (*globj); }
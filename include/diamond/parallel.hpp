@@ -0,0 +1,171 @@
+#pragma once
+
+#include "opengl.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+namespace NS_NAME {
+
+    // CPU worker pool for host side jobs (encoding, decoding, culling)
+    // GL calls are never issued from pool threads
+    class thread_pool {
+    protected:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> jobs;
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool stopping = false;
+
+        void worker_loop() {
+            for (;;) {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(mtx);
+                    cv.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                    if (stopping && jobs.empty()) return;
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+                job();
+            }
+        }
+
+    public:
+        thread_pool(size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+            for (size_t i = 0; i < threads; i++) {
+                workers.emplace_back([this]() { worker_loop(); });
+            }
+        }
+
+        ~thread_pool() {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                stopping = true;
+            }
+            cv.notify_all();
+            for (auto& w : workers) w.join();
+        }
+
+        size_t size() const {
+            return workers.size();
+        }
+
+        // queue single job, result by future
+        template<class F>
+        auto submit(F&& fn) -> std::future<decltype(fn())> {
+            using R = decltype(fn());
+            auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+            std::future<R> result = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                jobs.emplace_back([task]() { (*task)(); });
+            }
+            cv.notify_one();
+            return result;
+        }
+
+        // split [begin, end) to chunks of grain, call fn(chunk_begin, chunk_end)
+        // caller thread takes part, so nested calls from pool jobs do not deadlock
+        template<class F>
+        void parallel_for(size_t begin, size_t end, size_t grain, F&& fn) {
+            if (end <= begin) return;
+            grain = std::max(grain, size_t(1));
+            const size_t chunks = (end - begin + grain - 1) / grain;
+            if (chunks == 1 || workers.empty()) { fn(begin, end); return; }
+
+            struct shared_state {
+                std::atomic<size_t> next{ 0 };
+                std::atomic<size_t> done{ 0 };
+                std::mutex mtx;
+                std::condition_variable cv;
+            };
+            auto state = std::make_shared<shared_state>();
+            auto body = [state, begin, end, grain, chunks, &fn]() {
+                for (size_t c; (c = state->next.fetch_add(1)) < chunks;) {
+                    const size_t from = begin + c * grain;
+                    fn(from, std::min(from + grain, end));
+                    if (state->done.fetch_add(1) + 1 == chunks) {
+                        std::lock_guard<std::mutex> lock(state->mtx);
+                        state->cv.notify_all();
+                    }
+                }
+            };
+
+            // late helpers find no chunks left and return without touching fn
+            const size_t helpers = std::min(workers.size(), chunks - 1);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                for (size_t i = 0; i < helpers; i++) jobs.emplace_back(body);
+            }
+            cv.notify_all();
+
+            body();
+            std::unique_lock<std::mutex> lock(state->mtx);
+            state->cv.wait(lock, [&]() { return state->done.load() == chunks; });
+        }
+    };
+
+    // lock-free multi producer single consumer queue (Vyukov), push from any thread, pop from one
+    template<class T>
+    class mpsc_queue {
+    protected:
+        struct node {
+            std::atomic<node *> next{ nullptr };
+            T value;
+        };
+
+        std::atomic<node *> head;
+        node * tail;
+
+    public:
+        mpsc_queue() {
+            node * stub = new node();
+            head.store(stub);
+            tail = stub;
+        }
+
+        mpsc_queue(const mpsc_queue&) = delete;
+
+        ~mpsc_queue() {
+            T discard;
+            while (this->pop(discard)) {}
+            delete tail;
+        }
+
+        void push(T value) {
+            node * n = new node();
+            n->value = std::move(value);
+            node * prev = head.exchange(n, std::memory_order_acq_rel);
+            prev->next.store(n, std::memory_order_release);
+        }
+
+        // consumer only, false when empty (or push not yet linked)
+        bool pop(T& value) {
+            node * next = tail->next.load(std::memory_order_acquire);
+            if (!next) return false;
+            value = std::move(next->value);
+            delete tail;
+            tail = next;
+            return true;
+        }
+
+        // consumer only
+        bool empty() const {
+            return tail->next.load(std::memory_order_acquire) == nullptr;
+        }
+    };
+
+    // shared process-wide pool
+    thread_pool& default_pool() {
+        static thread_pool pool;
+        return pool;
+    }
+
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "program.hpp"
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include <algorithm>
+
+namespace NS_NAME {
+
+    // separable stage programs of one pipeline (0 is unused stage)
+    struct pipeline_stages {
+        GLuint vertex = 0;
+        GLuint tess_control = 0;
+        GLuint tess_evaluation = 0;
+        GLuint geometry = 0;
+        GLuint fragment = 0;
+        GLuint compute = 0;
+
+        pipeline_stages() {}
+        pipeline_stages(program& vertex, program& fragment) : vertex(vertex), fragment(fragment) {}
+
+        bool operator==(const pipeline_stages& o) const {
+            return vertex == o.vertex && tess_control == o.tess_control && tess_evaluation == o.tess_evaluation &&
+                   geometry == o.geometry && fragment == o.fragment && compute == o.compute;
+        }
+
+        bool uses(GLuint prog) const {
+            return prog && (vertex == prog || tess_control == prog || tess_evaluation == prog || geometry == prog || fragment == prog || compute == prog);
+        }
+    };
+
+    struct pipeline_stages_hash {
+        size_t operator()(const pipeline_stages& s) const {
+            uint64_t h = 14695981039346656037ull;
+            for (GLuint v : { s.vertex, s.tess_control, s.tess_evaluation, s.geometry, s.fragment, s.compute }) {
+                h ^= v;
+                h *= 1099511628211ull;
+            }
+            return size_t(h);
+        }
+    };
+
+
+    struct pipeline_cache_stats {
+        size_t pipelines = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;   // pipelines created
+        uint64_t evictions = 0;
+    };
+
+
+    // program pipelines interned by stage programs, least recently used are deleted over capacity
+    // returned pipeline stays valid until evicted, so capacity should exceed pipelines used per frame
+    class program_pipeline_cache {
+    protected:
+        struct entry {
+            pipeline_stages stages;
+            program_pipeline pipeline;
+
+            entry(const pipeline_stages& stages) : stages(stages) {}
+        };
+
+        std::list<entry> order; // front is most recent
+        std::unordered_map<pipeline_stages, std::list<entry>::iterator, pipeline_stages_hash> table;
+        size_t capacity;
+        pipeline_cache_stats counters;
+
+        void evict() {
+            while (order.size() > capacity) {
+                table.erase(order.back().stages);
+                order.pop_back();
+                counters.evictions++;
+            }
+        }
+
+    public:
+        program_pipeline_cache(size_t capacity = 256) : capacity(std::max(capacity, size_t(1))) {}
+
+        program_pipeline& get(const pipeline_stages& stages) {
+            auto found = table.find(stages);
+            if (found != table.end()) {
+                counters.hits++;
+                order.splice(order.begin(), order, found->second);
+                return found->second->pipeline;
+            }
+
+            counters.misses++;
+            order.emplace_front(stages);
+            const GLuint ppl = order.front().pipeline;
+            if (stages.vertex) glUseProgramStages(ppl, GL_VERTEX_SHADER_BIT, stages.vertex);
+            if (stages.tess_control) glUseProgramStages(ppl, GL_TESS_CONTROL_SHADER_BIT, stages.tess_control);
+            if (stages.tess_evaluation) glUseProgramStages(ppl, GL_TESS_EVALUATION_SHADER_BIT, stages.tess_evaluation);
+            if (stages.geometry) glUseProgramStages(ppl, GL_GEOMETRY_SHADER_BIT, stages.geometry);
+            if (stages.fragment) glUseProgramStages(ppl, GL_FRAGMENT_SHADER_BIT, stages.fragment);
+            if (stages.compute) glUseProgramStages(ppl, GL_COMPUTE_SHADER_BIT, stages.compute);
+            table.emplace(stages, order.begin());
+            evict();
+            return order.front().pipeline;
+        }
+
+        program_pipeline& get(program& vertex, program& fragment) {
+            return this->get(pipeline_stages(vertex, fragment));
+        }
+
+        // drops pipelines using program (before it is deleted)
+        void forget(GLuint prog) {
+            for (auto it = order.begin(); it != order.end();) {
+                if (it->stages.uses(prog)) {
+                    table.erase(it->stages);
+                    it = order.erase(it);
+                } else {
+                    it++;
+                }
+            }
+        }
+
+        void set_capacity(size_t pipelines) {
+            capacity = std::max(pipelines, size_t(1));
+            evict();
+        }
+
+        void clear() {
+            table.clear();
+            order.clear();
+        }
+
+        size_t size() const {
+            return order.size();
+        }
+
+        pipeline_cache_stats stats() const {
+            pipeline_cache_stats st = counters;
+            st.pipelines = order.size();
+            return st;
+        }
+    };
+
+};
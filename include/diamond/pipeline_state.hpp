@@ -0,0 +1,341 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "state.hpp"
+#include "program.hpp"
+#include "vertex_array.hpp"
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+namespace NS_NAME {
+
+    const GLuint max_blend_attachments = 8;
+
+    struct blend_attachment {
+        bool enabled = false;
+        GLenum src_rgb = GL_ONE;
+        GLenum dst_rgb = GL_ZERO;
+        GLenum src_alpha = GL_ONE;
+        GLenum dst_alpha = GL_ZERO;
+        GLenum equation_rgb = GL_FUNC_ADD;
+        GLenum equation_alpha = GL_FUNC_ADD;
+        GLuint write_mask = 0xF; // RGBA bits
+
+        // src * a + dst * (1 - a)
+        static blend_attachment alpha() {
+            blend_attachment b;
+            b.enabled = true;
+            b.src_rgb = GL_SRC_ALPHA; b.dst_rgb = GL_ONE_MINUS_SRC_ALPHA;
+            b.src_alpha = GL_ONE; b.dst_alpha = GL_ONE_MINUS_SRC_ALPHA;
+            return b;
+        }
+
+        static blend_attachment additive() {
+            blend_attachment b;
+            b.enabled = true;
+            b.src_rgb = b.dst_rgb = b.src_alpha = b.dst_alpha = GL_ONE;
+            return b;
+        }
+    };
+
+    // same stencil state for front and back faces
+    struct depth_stencil_state {
+        bool depth_test = false;
+        bool depth_write = true;
+        GLenum depth_func = GL_LESS;
+        bool stencil_test = false;
+        GLenum stencil_func = GL_ALWAYS;
+        GLint stencil_ref = 0;
+        GLuint stencil_read_mask = 0xFF;
+        GLuint stencil_write_mask = 0xFF;
+        GLenum stencil_fail = GL_KEEP;
+        GLenum depth_fail = GL_KEEP;
+        GLenum depth_pass = GL_KEEP;
+    };
+
+    struct raster_state {
+        GLenum polygon_mode = GL_FILL;
+        bool cull = false;
+        GLenum cull_face = GL_BACK;
+        GLenum front_face = GL_CCW;
+        bool scissor_test = false;
+        bool polygon_offset = false; // fill mode
+        float offset_factor = 0.f;
+        float offset_units = 0.f;
+        bool depth_clamp = false;
+        bool multisample = true;
+        bool rasterizer_discard = false;
+    };
+
+
+    // mutable description, interned to immutable pipeline_state
+    // program, pipeline and vertex array are referenced by name (objects must outlive states using them)
+    struct pipeline_desc {
+        GLuint program = 0;          // takes precedence over pipeline
+        GLuint pipeline = 0;
+        GLuint vertex_array = 0;
+        blend_attachment blend[max_blend_attachments];
+        glm::vec4 blend_color = glm::vec4(0.f);
+        depth_stencil_state depth_stencil;
+        raster_state raster;
+        std::vector<GLenum> features; // other enabled capabilities (sorted)
+
+        pipeline_desc& use_program(NS_NAME::program& prog) {
+            program = prog;
+            pipeline = 0; // unused while program is bound
+            return thisref;
+        }
+
+        pipeline_desc& use_pipeline(program_pipeline& ppl) {
+            program = 0;
+            pipeline = ppl;
+            return thisref;
+        }
+
+        pipeline_desc& use_vertex_array(NS_NAME::vertex_array& vao) {
+            vertex_array = vao;
+            return thisref;
+        }
+
+        pipeline_desc& set_blend(GLuint draw_buffer, const blend_attachment& state) {
+            blend[draw_buffer] = state;
+            return thisref;
+        }
+
+        pipeline_desc& set_blend(const blend_attachment& state) {
+            for (auto& b : blend) b = state;
+            return thisref;
+        }
+
+        pipeline_desc& enable(_feature& feature) {
+            return this->enable(GLenum(feature));
+        }
+
+        pipeline_desc& enable(GLenum feature) {
+            auto at = std::lower_bound(features.begin(), features.end(), feature);
+            if (at == features.end() || *at != feature) features.insert(at, feature);
+            return thisref;
+        }
+
+        // canonical words for hashing and equality
+        std::vector<uint32_t> key() const {
+            std::vector<uint32_t> words;
+            words.reserve(96 + features.size());
+            auto f = [&](float v) { uint32_t w; std::memcpy(&w, &v, 4); words.push_back(w); };
+            words.insert(words.end(), { program, program ? 0u : pipeline, vertex_array });
+            for (auto& b : blend) {
+                words.insert(words.end(), { uint32_t(b.enabled), b.src_rgb, b.dst_rgb, b.src_alpha, b.dst_alpha, b.equation_rgb, b.equation_alpha, b.write_mask });
+            }
+            for (int i = 0; i < 4; i++) f(blend_color[i]);
+            const depth_stencil_state& d = depth_stencil;
+            words.insert(words.end(), { uint32_t(d.depth_test), uint32_t(d.depth_write), d.depth_func, uint32_t(d.stencil_test), d.stencil_func,
+                                        uint32_t(d.stencil_ref), d.stencil_read_mask, d.stencil_write_mask, d.stencil_fail, d.depth_fail, d.depth_pass });
+            const raster_state& r = raster;
+            words.insert(words.end(), { r.polygon_mode, uint32_t(r.cull), r.cull_face, r.front_face, uint32_t(r.scissor_test), uint32_t(r.polygon_offset) });
+            f(r.offset_factor);
+            f(r.offset_units);
+            words.insert(words.end(), { uint32_t(r.depth_clamp), uint32_t(r.multisample), uint32_t(r.rasterizer_discard) });
+            words.insert(words.end(), features.begin(), features.end());
+            return words;
+        }
+    };
+
+
+    // immutable interned state, compare by address
+    class pipeline_state {
+    protected:
+        friend class _pipeline_states;
+        pipeline_desc desc;
+        std::vector<uint32_t> words;
+        size_t hash_value = 0;
+        GLuint id = 0;
+
+        pipeline_state(const pipeline_desc& desc, std::vector<uint32_t>&& words, size_t hash_value, GLuint id)
+            : desc(desc), words(std::move(words)), hash_value(hash_value), id(id) {}
+
+    public:
+        pipeline_state(const pipeline_state&) = delete;
+
+        const pipeline_desc& description() const {
+            return desc;
+        }
+
+        size_t hash() const {
+            return hash_value;
+        }
+
+        // dense index in creation order (sorting draws by state)
+        GLuint index() const {
+            return id;
+        }
+    };
+
+
+    struct pipeline_state_stats {
+        size_t states = 0;      // interned
+        uint64_t applies = 0;
+        uint64_t redundant = 0; // same state as bound
+        uint64_t gl_calls = 0;  // issued by diffs
+    };
+
+
+    // interns states and applies them by diff against bound one
+    // piecemeal changes (blend, option, managment) between applies need invalidate()
+    class _pipeline_states {
+    protected:
+        std::unordered_map<size_t, std::vector<std::unique_ptr<pipeline_state>>> table;
+        std::vector<const pipeline_state *> by_index;
+        const pipeline_state * bound = nullptr;
+        GLuint vertex_array = 0; // actually bound (may differ from bound state, see note_vertex_array)
+        pipeline_state_stats counters;
+
+        static size_t hash_words(const std::vector<uint32_t>& words) {
+            uint64_t h = 14695981039346656037ull; // FNV-1a
+            for (uint32_t w : words) {
+                for (int i = 0; i < 4; i++) {
+                    h ^= (w >> (i * 8)) & 0xFF;
+                    h *= 1099511628211ull;
+                }
+            }
+            return size_t(h);
+        }
+
+        void toggle(GLenum cap, bool on) {
+            if (on) glEnable(cap); else glDisable(cap);
+            counters.gl_calls++;
+        }
+
+        // prev is null when GL state is unknown (everything issued)
+        void transition(const pipeline_desc * prev, const pipeline_desc& next) {
+            const bool all = prev == nullptr;
+            uint64_t& calls = counters.gl_calls;
+
+            // bound pipeline is known only when prev drew through it (program states leave an older one bound)
+            if (all || prev->program != next.program) { glUseProgram(next.program); calls++; }
+            if (next.program == 0 && (all || prev->program != 0 || prev->pipeline != next.pipeline)) { glBindProgramPipeline(next.pipeline); calls++; }
+            if (all || vertex_array != next.vertex_array) { glBindVertexArray(next.vertex_array); calls++; }
+            vertex_array = next.vertex_array;
+
+            for (GLuint i = 0; i < max_blend_attachments; i++) {
+                const blend_attachment& b = next.blend[i];
+                const blend_attachment * p = all ? nullptr : &prev->blend[i];
+                if (!p || p->enabled != b.enabled) {
+                    if (b.enabled) glEnablei(GL_BLEND, i); else glDisablei(GL_BLEND, i);
+                    calls++;
+                }
+                if (!p || p->src_rgb != b.src_rgb || p->dst_rgb != b.dst_rgb || p->src_alpha != b.src_alpha || p->dst_alpha != b.dst_alpha) {
+                    glBlendFuncSeparatei(i, b.src_rgb, b.dst_rgb, b.src_alpha, b.dst_alpha);
+                    calls++;
+                }
+                if (!p || p->equation_rgb != b.equation_rgb || p->equation_alpha != b.equation_alpha) {
+                    glBlendEquationSeparatei(i, b.equation_rgb, b.equation_alpha);
+                    calls++;
+                }
+                if (!p || p->write_mask != b.write_mask) {
+                    glColorMaski(i, b.write_mask & 1, (b.write_mask >> 1) & 1, (b.write_mask >> 2) & 1, (b.write_mask >> 3) & 1);
+                    calls++;
+                }
+            }
+            if (all || prev->blend_color != next.blend_color) { glBlendColor(next.blend_color.x, next.blend_color.y, next.blend_color.z, next.blend_color.w); calls++; }
+
+            const depth_stencil_state& d = next.depth_stencil;
+            const depth_stencil_state * pd = all ? nullptr : &prev->depth_stencil;
+            if (!pd || pd->depth_test != d.depth_test) toggle(GL_DEPTH_TEST, d.depth_test);
+            if (!pd || pd->depth_write != d.depth_write) { glDepthMask(d.depth_write); calls++; }
+            if (!pd || pd->depth_func != d.depth_func) { glDepthFunc(d.depth_func); calls++; }
+            if (!pd || pd->stencil_test != d.stencil_test) toggle(GL_STENCIL_TEST, d.stencil_test);
+            if (!pd || pd->stencil_func != d.stencil_func || pd->stencil_ref != d.stencil_ref || pd->stencil_read_mask != d.stencil_read_mask) {
+                glStencilFunc(d.stencil_func, d.stencil_ref, d.stencil_read_mask);
+                calls++;
+            }
+            if (!pd || pd->stencil_write_mask != d.stencil_write_mask) { glStencilMask(d.stencil_write_mask); calls++; }
+            if (!pd || pd->stencil_fail != d.stencil_fail || pd->depth_fail != d.depth_fail || pd->depth_pass != d.depth_pass) {
+                glStencilOp(d.stencil_fail, d.depth_fail, d.depth_pass);
+                calls++;
+            }
+
+            const raster_state& r = next.raster;
+            const raster_state * pr = all ? nullptr : &prev->raster;
+            if (!pr || pr->polygon_mode != r.polygon_mode) { glPolygonMode(GL_FRONT_AND_BACK, r.polygon_mode); calls++; }
+            if (!pr || pr->cull != r.cull) toggle(GL_CULL_FACE, r.cull);
+            if (!pr || pr->cull_face != r.cull_face) { glCullFace(r.cull_face); calls++; }
+            if (!pr || pr->front_face != r.front_face) { glFrontFace(r.front_face); calls++; }
+            if (!pr || pr->scissor_test != r.scissor_test) toggle(GL_SCISSOR_TEST, r.scissor_test);
+            if (!pr || pr->polygon_offset != r.polygon_offset) toggle(GL_POLYGON_OFFSET_FILL, r.polygon_offset);
+            if (!pr || pr->offset_factor != r.offset_factor || pr->offset_units != r.offset_units) { glPolygonOffset(r.offset_factor, r.offset_units); calls++; }
+            if (!pr || pr->depth_clamp != r.depth_clamp) toggle(GL_DEPTH_CLAMP, r.depth_clamp);
+            if (!pr || pr->multisample != r.multisample) toggle(GL_MULTISAMPLE, r.multisample);
+            if (!pr || pr->rasterizer_discard != r.rasterizer_discard) toggle(GL_RASTERIZER_DISCARD, r.rasterizer_discard);
+
+            // sorted sets, unknown previous state only enables
+            if (all) {
+                for (GLenum cap : next.features) toggle(cap, true);
+            } else {
+                auto a = prev->features.begin(), b = next.features.begin();
+                while (a != prev->features.end() || b != next.features.end()) {
+                    if (b == next.features.end() || (a != prev->features.end() && *a < *b)) toggle(*a++, false);
+                    else if (a == prev->features.end() || *b < *a) toggle(*b++, true);
+                    else { a++; b++; }
+                }
+            }
+        }
+
+    public:
+        // same description always returns same state
+        const pipeline_state& intern(const pipeline_desc& desc) {
+            std::vector<uint32_t> words = desc.key();
+            const size_t h = hash_words(words);
+            auto& bucket = table[h];
+            for (auto& s : bucket) {
+                if (s->words == words) return *s;
+            }
+            bucket.emplace_back(new pipeline_state(desc, std::move(words), h, GLuint(by_index.size())));
+            by_index.push_back(bucket.back().get());
+            counters.states++;
+            return *bucket.back();
+        }
+
+        // issues only calls that differ from bound state
+        void apply(const pipeline_state& state) {
+            counters.applies++;
+            if (bound == &state && vertex_array == state.desc.vertex_array) { counters.redundant++; return; }
+            transition(bound ? &bound->desc : nullptr, state.desc);
+            bound = &state;
+        }
+
+        // GL state was changed outside, next apply issues everything
+        void invalidate() {
+            bound = nullptr;
+        }
+
+        // vertex array was bound outside (per mesh draws under one state), rest of shadow stays valid
+        void note_vertex_array(GLuint vao) {
+            vertex_array = vao;
+        }
+
+        const pipeline_state * current() const {
+            return bound;
+        }
+
+        const pipeline_state& get(GLuint index) const {
+            return *by_index[index];
+        }
+
+        pipeline_state_stats stats() const {
+            return counters;
+        }
+
+        void reset_stats() {
+            const size_t states = counters.states;
+            counters = pipeline_state_stats();
+            counters.states = states;
+        }
+    };
+
+    _pipeline_states pipeline_states;
+
+};
@@ -16,6 +16,9 @@ namespace NS_NAME {
         static void release(GLuint * heap){
             glDeleteShader(*heap);
         }
+        static void release_n(GLsizei n, const GLuint * heap){
+            for (GLsizei i = 0; i < n; i++) glDeleteShader(heap[i]);
+        }
     };
 
     class shader: public gl_object<shader_builder> {
@@ -107,6 +110,12 @@ namespace NS_NAME {
             if constexpr (std::is_same<T, double>::value) glProgramUniform1d(program, thisref, value);
             if constexpr (std::is_same<T, int64_t>::value) glProgramUniform1i64ARB(program, thisref, value);
             if constexpr (std::is_same<T, uint64_t>::value) glProgramUniform1ui64ARB(program, thisref, value);
+            if constexpr (std::is_same<T, glm::vec2>::value) glProgramUniform2fv(program, thisref, 1, &value.x);
+            if constexpr (std::is_same<T, glm::vec3>::value) glProgramUniform3fv(program, thisref, 1, &value.x);
+            if constexpr (std::is_same<T, glm::vec4>::value) glProgramUniform4fv(program, thisref, 1, &value.x);
+            if constexpr (std::is_same<T, glm::ivec2>::value) glProgramUniform2iv(program, thisref, 1, &value.x);
+            if constexpr (std::is_same<T, glm::uvec2>::value) glProgramUniform2uiv(program, thisref, 1, &value.x);
+            if constexpr (std::is_same<T, glm::mat4>::value) glProgramUniformMatrix4fv(program, thisref, 1, GL_FALSE, &value[0][0]);
         }
 
         template<class T>
@@ -172,7 +181,10 @@ namespace NS_NAME {
         }
 
         static void release(GLuint * heap){
-            glDeleteShader(*heap);
+            glDeleteProgram(*heap);
+        }
+        static void release_n(GLsizei n, const GLuint * heap){
+            for (GLsizei i = 0; i < n; i++) glDeleteProgram(heap[i]);
         }
     };
 
@@ -252,7 +264,10 @@ namespace NS_NAME {
             glCreateProgramPipelines(1, heap);
         }
         static void release(GLuint * heap){
-            glCreateProgramPipelines(1, heap);
+            glDeleteProgramPipelines(1, heap);
+        }
+        static void release_n(GLsizei n, const GLuint * heap){
+            glDeleteProgramPipelines(n, heap);
         }
     };
 
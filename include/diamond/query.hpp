@@ -0,0 +1,218 @@
+#pragma once
+
+#include "opengl.hpp"
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace NS_NAME {
+
+    class query_builder {
+    public:
+        static void create(GLuint * heap, GLenum target) {
+            glCreateQueries(target, 1, heap);
+        }
+        static void release(GLuint * heap) {
+            glDeleteQueries(1, heap);
+        }
+        static void release_n(GLsizei n, const GLuint * heap) {
+            glDeleteQueries(n, heap);
+        }
+    };
+
+
+    // query object (occlusion, primitives, time elapsed)
+    class query: public gl_object<query_builder> {
+    protected:
+        using base = gl_object<query_builder>;
+        GLenum gltarget = GL_ANY_SAMPLES_PASSED_CONSERVATIVE;
+
+    public:
+
+        // constructor (variadic)
+        query(GLenum target = GL_ANY_SAMPLES_PASSED_CONSERVATIVE) { base::create_alloc(target); gltarget = target; }
+        query(query& another) { base::move(another); gltarget = another.gltarget; } // copy (it refs)
+        query(query&& another) { base::move(std::forward<query>(another)); gltarget = another.gltarget; } // move
+        query(GLenum target, GLuint * another) { base::move(another); gltarget = target; } // heap by ptr
+
+        void begin() {
+            glBeginQuery(gltarget, thisref);
+        }
+
+        void end() {
+            glEndQuery(gltarget);
+        }
+
+        // result is ready without stall
+        bool available() const {
+            GLuint ready = 0;
+            glGetQueryObjectuiv(thisref, GL_QUERY_RESULT_AVAILABLE, &ready);
+            return ready != 0;
+        }
+
+        // blocks until result is ready
+        GLuint64 result() const {
+            GLuint64 value = 0;
+            glGetQueryObjectui64v(thisref, GL_QUERY_RESULT, &value);
+            return value;
+        }
+
+        // false (value untouched) when not ready
+        bool result_no_wait(GLuint64& value) const {
+            if (!this->available()) return false;
+            value = this->result();
+            return true;
+        }
+
+        GLenum target() const {
+            return gltarget;
+        }
+    };
+
+
+    struct query_pool_stats {
+        size_t queries = 0;     // created
+        size_t pending = 0;     // ended, result not collected
+        uint64_t resolved = 0;
+    };
+
+
+    // recycled queries keyed by user id (object, draw), results collected without blocking
+    class query_pool {
+    protected:
+        struct slot {
+            query q;
+            uint64_t key = 0;
+            uint64_t frame = 0;
+            bool pending = false; // result not collected
+            bool latest = false;  // newest ended query of key
+
+            slot(GLenum target) : q(target) {}
+            slot(slot&& another) : q(std::move(another.q)), key(another.key), frame(another.frame), pending(another.pending), latest(another.latest) {}
+        };
+
+        struct result_entry {
+            GLuint64 value = 0;
+            uint64_t frame = 0;
+        };
+
+        GLenum gltarget;
+        std::deque<slot> slots; // stable references
+        std::vector<size_t> free_slots;
+        std::vector<size_t> pending_slots;
+        std::unordered_map<uint64_t, size_t> latest_slot;
+        std::unordered_map<uint64_t, result_entry> results;
+        size_t active = SIZE_MAX;
+        uint64_t frame = 0;
+        uint64_t resolved = 0;
+
+        void recycle(size_t index) {
+            slot& s = slots[index];
+            if (!s.pending && !s.latest) free_slots.push_back(index);
+        }
+
+    public:
+        // target: GL_ANY_SAMPLES_PASSED_CONSERVATIVE, GL_ANY_SAMPLES_PASSED, GL_SAMPLES_PASSED, GL_PRIMITIVES_GENERATED
+        query_pool(GLenum target = GL_ANY_SAMPLES_PASSED_CONSERVATIVE) : gltarget(target) {}
+
+        // one query of pool target may be active at a time
+        query& begin(uint64_t key) {
+            size_t index;
+            if (!free_slots.empty()) {
+                index = free_slots.back();
+                free_slots.pop_back();
+            } else {
+                index = slots.size();
+                slots.emplace_back(gltarget);
+            }
+            slot& s = slots[index];
+            s.key = key;
+            s.frame = frame;
+            s.q.begin();
+            active = index;
+            return s.q;
+        }
+
+        void end() {
+            if (active == SIZE_MAX) return;
+            slot& s = slots[active];
+            s.q.end();
+            s.pending = true;
+            s.latest = true;
+            pending_slots.push_back(active);
+
+            auto found = latest_slot.find(s.key);
+            if (found != latest_slot.end()) {
+                slots[found->second].latest = false;
+                recycle(found->second);
+                found->second = active;
+            } else {
+                latest_slot.emplace(s.key, active);
+            }
+            active = SIZE_MAX;
+        }
+
+        // newest ended query of key (for conditional render), nullptr if none
+        query * latest(uint64_t key) {
+            auto found = latest_slot.find(key);
+            return found != latest_slot.end() ? &slots[found->second].q : nullptr;
+        }
+
+        // collect ready results (never blocks), call once per frame
+        void next_frame() {
+            size_t kept = 0;
+            for (size_t i = 0; i < pending_slots.size(); i++) {
+                const size_t index = pending_slots[i];
+                slot& s = slots[index];
+                GLuint64 value = 0;
+                if (!s.q.result_no_wait(value)) {
+                    pending_slots[kept++] = index;
+                    continue;
+                }
+                if (latest_slot.count(s.key)) {
+                    auto& entry = results[s.key];
+                    if (s.frame >= entry.frame) entry = { value, s.frame };
+                }
+                s.pending = false;
+                resolved++;
+                recycle(index);
+            }
+            pending_slots.resize(kept);
+            frame++;
+        }
+
+        // newest collected result of key and frame it was issued in
+        bool result(uint64_t key, GLuint64& value, uint64_t * issued = nullptr) const {
+            auto found = results.find(key);
+            if (found == results.end()) return false;
+            value = found->second.value;
+            if (issued) *issued = found->second.frame;
+            return true;
+        }
+
+        // drops key state (object removed), its queries are recycled when collected
+        void forget(uint64_t key) {
+            auto found = latest_slot.find(key);
+            if (found != latest_slot.end()) {
+                slots[found->second].latest = false;
+                recycle(found->second);
+                latest_slot.erase(found);
+            }
+            results.erase(key);
+        }
+
+        query_pool_stats stats() const {
+            query_pool_stats st;
+            st.queries = slots.size();
+            st.pending = pending_slots.size();
+            st.resolved = resolved;
+            return st;
+        }
+
+        GLenum target() const {
+            return gltarget;
+        }
+    };
+
+};
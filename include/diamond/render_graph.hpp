@@ -0,0 +1,498 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "enums.hpp"
+#include "buffer.hpp"
+#include "texture.hpp"
+#include "texture_pool.hpp"
+#include "command.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+
+namespace NS_NAME {
+
+    // how pass uses resource, selects barrier bits after incoherent writes
+    enum class resource_access {
+        vertex,          // vertex attribute fetch
+        index,           // element array
+        uniform,         // uniform block
+        texture_fetch,   // sampler (texelFetch, texture)
+        image,           // image load/store (incoherent write)
+        shader_storage,  // SSBO (incoherent write)
+        atomic_counter,  // atomic counters (incoherent write)
+        indirect,        // draw/dispatch indirect, parameter buffer
+        framebuffer,     // color/depth attachment
+        transfer,        // copies, subdata, subimage, blit
+        host             // readback or client mapping
+    };
+
+
+    struct graph_resource {
+        uint32_t index = uint32_t(-1);
+
+        bool valid() const {
+            return index != uint32_t(-1);
+        }
+    };
+
+
+    struct render_graph_stats {
+        size_t passes = 0;
+        size_t culled_passes = 0;
+        size_t barriers = 0;
+        size_t transient_textures = 0;
+        size_t texture_slots = 0; // distinct textures after aliasing
+        size_t transient_buffer_bytes = 0; // sum without aliasing
+        size_t arena_bytes = 0; // with aliasing
+    };
+
+
+    class render_graph;
+
+    // declares resource usage of pass
+    class render_pass_builder {
+    protected:
+        friend render_graph;
+        render_graph * graph;
+        uint32_t pass;
+
+        render_pass_builder(render_graph& graph, uint32_t pass) : graph(&graph), pass(pass) {}
+
+    public:
+        render_pass_builder& read(graph_resource res, resource_access access);
+        render_pass_builder& write(graph_resource res, resource_access access);
+        render_pass_builder& side_effect(); // never culled
+    };
+
+
+    // frame graph: ordered passes, culling, minimal glMemoryBarrier, transient aliasing
+    class render_graph {
+    protected:
+        friend render_pass_builder;
+
+        struct resource_node {
+            bool imported = false;
+            bool is_texture = false;
+            texture_desc desc;
+            GLsizeiptr size = 0;
+            size_t slot = 0; // texture slot or imported buffer slot
+            GLintptr offset = 0; // arena offset of transient buffer
+            int first = -1, last = -1; // lifetime in compiled order
+            std::vector<uint32_t> aliases; // earlier resources sharing memory
+        };
+
+        struct pass_node {
+            std::string name;
+            std::vector<std::pair<uint32_t, resource_access>> reads, writes;
+            std::function<void(render_graph&)> fn;
+            bool side_effect = false;
+            bool alive = true;
+            memory_barrier_bits barrier;
+        };
+
+        std::vector<resource_node> resources;
+        std::vector<pass_node> passes;
+        std::deque<texture> texture_slots;
+        std::deque<buffer> buffer_slots;
+        std::vector<texture_desc> slot_desc;
+        std::vector<int> slot_free_after;
+        std::deque<texture> spare_slots; // transient textures of previous compile (pool keeps them this frame)
+        std::vector<texture_desc> spare_desc;
+        std::vector<bool> spare_taken;
+        buffer * arena = nullptr;
+        GLsizeiptr arena_size = 0;
+        texture_pool own_pool;
+        texture_pool * pool;
+        render_graph_stats counters;
+        bool compiled = false;
+
+        static bool incoherent(resource_access access) {
+            return access == resource_access::image || access == resource_access::shader_storage || access == resource_access::atomic_counter;
+        }
+
+        static GLbitfield barrier_of(resource_access access, bool is_texture) {
+            switch (access) {
+                case resource_access::vertex: return GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT;
+                case resource_access::index: return GL_ELEMENT_ARRAY_BARRIER_BIT;
+                case resource_access::uniform: return GL_UNIFORM_BARRIER_BIT;
+                case resource_access::texture_fetch: return GL_TEXTURE_FETCH_BARRIER_BIT;
+                case resource_access::image: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+                case resource_access::shader_storage: return GL_SHADER_STORAGE_BARRIER_BIT;
+                case resource_access::atomic_counter: return GL_ATOMIC_COUNTER_BARRIER_BIT;
+                case resource_access::indirect: return GL_COMMAND_BARRIER_BIT;
+                case resource_access::framebuffer: return GL_FRAMEBUFFER_BARRIER_BIT;
+                case resource_access::transfer: return is_texture ? GL_TEXTURE_UPDATE_BARRIER_BIT : GL_BUFFER_UPDATE_BARRIER_BIT;
+                case resource_access::host: return is_texture ? GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT : GL_BUFFER_UPDATE_BARRIER_BIT | GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT;
+            }
+            return GL_ALL_BARRIER_BITS;
+        }
+
+        // backwards walk: pass is alive when its output is consumed by alive pass or leaves graph
+        void cull() {
+            std::vector<bool> needed(resources.size(), false);
+            for (size_t p = passes.size(); p-- > 0;) {
+                pass_node& pass = passes[p];
+                pass.alive = pass.side_effect;
+                for (auto& w : pass.writes) {
+                    if (resources[w.first].imported || needed[w.first]) pass.alive = true;
+                }
+                if (!pass.alive) { counters.culled_passes++; continue; }
+                for (auto& r : pass.reads) needed[r.first] = true;
+            }
+        }
+
+        // drops results of previous compile, imported textures keep their slots (renumbered)
+        void reset_compiled() {
+            std::vector<size_t> remap(texture_slots.size(), SIZE_MAX);
+            std::deque<texture> imported;
+            for (auto& node : resources) {
+                if (!node.imported || !node.is_texture) continue;
+                if (remap[node.slot] == SIZE_MAX) {
+                    remap[node.slot] = imported.size();
+                    imported.emplace_back(texture_slots[node.slot]);
+                }
+                node.slot = remap[node.slot];
+            }
+
+            spare_slots.clear();
+            spare_desc.clear();
+            for (size_t s = 0; s < texture_slots.size(); s++) {
+                if (remap[s] != SIZE_MAX) continue;
+                spare_slots.emplace_back(texture_slots[s]);
+                spare_desc.push_back(slot_desc[s]);
+            }
+            spare_taken.assign(spare_slots.size(), false);
+
+            texture_slots.clear();
+            slot_desc.clear();
+            slot_free_after.clear();
+            for (auto& tex : imported) {
+                texture_slots.emplace_back(tex);
+                slot_desc.push_back(texture_desc());
+                slot_free_after.push_back(std::numeric_limits<int>::max());
+            }
+
+            for (auto& node : resources) {
+                node.first = node.last = -1;
+                node.aliases.clear();
+                node.offset = 0;
+                if (!node.imported) node.slot = 0;
+            }
+        }
+
+        // transient texture of desc, previous compile's texture when one is spare
+        texture take_texture(const texture_desc& desc) {
+            for (size_t s = 0; s < spare_slots.size(); s++) {
+                if (!spare_taken[s] && spare_desc[s] == desc) {
+                    spare_taken[s] = true;
+                    return texture(spare_slots[s]);
+                }
+            }
+            return pool->acquire(desc);
+        }
+
+        void lifetimes() {
+            int order = 0;
+            for (auto& pass : passes) {
+                if (!pass.alive) continue;
+                auto touch = [&](uint32_t res) {
+                    resource_node& node = resources[res];
+                    if (node.first < 0) node.first = order;
+                    node.last = order;
+                };
+                for (auto& r : pass.reads) touch(r.first);
+                for (auto& w : pass.writes) touch(w.first);
+                order++;
+            }
+        }
+
+        // same description textures with disjoint lifetimes share one texture
+        void alias_textures() {
+            std::vector<uint32_t> order;
+            for (uint32_t i = 0; i < resources.size(); i++) {
+                if (resources[i].is_texture && !resources[i].imported && resources[i].first >= 0) order.push_back(i);
+            }
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return resources[a].first < resources[b].first; });
+
+            std::vector<std::vector<uint32_t>> slot_users(texture_slots.size());
+            for (uint32_t i : order) {
+                resource_node& node = resources[i];
+                counters.transient_textures++;
+                size_t slot = texture_slots.size();
+                for (size_t s = 0; s < slot_desc.size(); s++) {
+                    if (slot_free_after[s] < node.first && slot_desc[s] == node.desc) { slot = s; break; }
+                }
+                if (slot == texture_slots.size()) {
+                    texture_slots.emplace_back(this->take_texture(node.desc));
+                    slot_desc.push_back(node.desc);
+                    slot_free_after.push_back(node.last);
+                    slot_users.emplace_back();
+                    counters.texture_slots++;
+                }
+                node.slot = slot;
+                node.aliases = slot_users[slot];
+                slot_users[slot].push_back(i);
+                slot_free_after[slot] = node.last;
+            }
+        }
+
+        // place transient buffers in shared arena, lowest offset not overlapping live ranges
+        void alias_buffers() {
+            GLint ssbo_align = 256, ubo_align = 256;
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &ssbo_align);
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &ubo_align);
+            const GLintptr align = std::max(GLintptr(std::max(ssbo_align, ubo_align)), GLintptr(16));
+
+            std::vector<uint32_t> order;
+            for (uint32_t i = 0; i < resources.size(); i++) {
+                if (!resources[i].is_texture && !resources[i].imported && resources[i].first >= 0) order.push_back(i);
+            }
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return resources[a].size > resources[b].size; });
+
+            std::vector<uint32_t> placed;
+            GLsizeiptr total = 0;
+            for (uint32_t i : order) {
+                resource_node& node = resources[i];
+                counters.transient_buffer_bytes += size_t(node.size);
+
+                // candidate offsets: zero and ends of overlapping live ranges
+                std::vector<uint32_t> conflicts;
+                std::vector<GLintptr> candidates = { 0 };
+                for (uint32_t j : placed) {
+                    const resource_node& other = resources[j];
+                    if (other.last < node.first || node.last < other.first) continue;
+                    conflicts.push_back(j);
+                    candidates.push_back((other.offset + other.size + align - 1) / align * align);
+                }
+                std::sort(candidates.begin(), candidates.end());
+
+                for (GLintptr offset : candidates) {
+                    bool fits = true;
+                    for (uint32_t j : conflicts) {
+                        const resource_node& other = resources[j];
+                        if (offset < other.offset + other.size && other.offset < offset + node.size) { fits = false; break; }
+                    }
+                    if (fits) { node.offset = offset; break; }
+                }
+
+                // earlier dead ranges overlapping this memory pass their pending writes
+                for (uint32_t j : placed) {
+                    const resource_node& other = resources[j];
+                    if (other.last < node.first && node.offset < other.offset + other.size && other.offset < node.offset + node.size) node.aliases.push_back(j);
+                }
+                placed.push_back(i);
+                total = std::max(total, GLsizeiptr(node.offset + node.size));
+            }
+
+            counters.arena_bytes = size_t(total);
+            if (total > arena_size) {
+                delete arena;
+                arena = new buffer();
+                arena->storage(total, nullptr, 0);
+                arena_size = total;
+            }
+        }
+
+        // minimal barrier bits before each alive pass
+        void barriers() {
+            struct state {
+                bool pending = false;
+                GLbitfield issued = 0;
+            };
+            std::vector<state> states(resources.size());
+            std::vector<bool> started(resources.size(), false);
+
+            for (auto& pass : passes) {
+                if (!pass.alive) continue;
+                GLbitfield bits = 0;
+                auto need = [&](uint32_t res, resource_access access) {
+                    state& st = states[res];
+                    if (!started[res]) {
+                        started[res] = true;
+                        for (uint32_t a : resources[res].aliases) {
+                            if (!states[a].pending) continue;
+                            st.issued = st.pending ? (st.issued & states[a].issued) : states[a].issued;
+                            st.pending = true;
+                        }
+                    }
+                    const GLbitfield bit = barrier_of(access, resources[res].is_texture);
+                    if (st.pending && (st.issued & bit) != bit) bits |= bit;
+                };
+                for (auto& r : pass.reads) need(r.first, r.second);
+                for (auto& w : pass.writes) need(w.first, w.second);
+
+                pass.barrier = memory_barrier_bits(bits);
+                if (bits) {
+                    counters.barriers++;
+                    for (auto& st : states) if (st.pending) st.issued |= bits;
+                }
+
+                for (auto& w : pass.writes) {
+                    if (!incoherent(w.second)) continue;
+                    states[w.first].pending = true;
+                    states[w.first].issued = 0;
+                }
+            }
+        }
+
+    public:
+        render_graph() : pool(&own_pool) {}
+        render_graph(texture_pool& pool) : pool(&pool) {}
+        ~render_graph() { delete arena; }
+
+        render_graph(const render_graph& another) = delete;
+        render_graph& operator=(const render_graph& another) = delete;
+
+
+        // external resources (results persist after graph)
+        graph_resource import_texture(texture& tex) {
+            resource_node node;
+            node.imported = true;
+            node.is_texture = true;
+            node.slot = texture_slots.size();
+            texture_slots.emplace_back(tex);
+            slot_desc.push_back(texture_desc());
+            slot_free_after.push_back(std::numeric_limits<int>::max()); // never reused
+            resources.push_back(node);
+            return graph_resource{ uint32_t(resources.size() - 1) };
+        }
+
+        graph_resource import_buffer(buffer& buf) {
+            resource_node node;
+            node.imported = true;
+            node.slot = buffer_slots.size();
+            buffer_slots.emplace_back(buf);
+            resources.push_back(node);
+            return graph_resource{ uint32_t(resources.size() - 1) };
+        }
+
+        // transient resources (contents undefined at first use)
+        graph_resource create_texture(const texture_desc& desc) {
+            resource_node node;
+            node.is_texture = true;
+            node.desc = desc;
+            resources.push_back(node);
+            return graph_resource{ uint32_t(resources.size() - 1) };
+        }
+
+        graph_resource create_buffer(GLsizeiptr size) {
+            resource_node node;
+            node.size = size;
+            resources.push_back(node);
+            return graph_resource{ uint32_t(resources.size() - 1) };
+        }
+
+        render_pass_builder add_pass(std::string name, std::function<void(render_graph&)> fn) {
+            pass_node pass;
+            pass.name = std::move(name);
+            pass.fn = std::move(fn);
+            passes.push_back(std::move(pass));
+            compiled = false;
+            return render_pass_builder(thisref, uint32_t(passes.size() - 1));
+        }
+
+
+        // cull, compute lifetimes, alias transients and place barriers (again after add_pass)
+        void compile() {
+            if (compiled) return;
+            counters = render_graph_stats();
+            counters.passes = passes.size();
+            reset_compiled();
+            cull();
+            lifetimes();
+            alias_textures();
+            alias_buffers();
+            barriers();
+            spare_slots.clear();
+            spare_desc.clear();
+            spare_taken.clear();
+            compiled = true;
+        }
+
+        void execute() {
+            if (!compiled) compile();
+            for (auto& pass : passes) {
+                if (!pass.alive) continue;
+                commands.memory_barrier(pass.barrier);
+                if (pass.fn) pass.fn(thisref);
+            }
+        }
+
+        // drop passes and resources for next frame (arena is kept)
+        void reset() {
+            resources.clear();
+            passes.clear();
+            texture_slots.clear();
+            buffer_slots.clear();
+            slot_desc.clear();
+            slot_free_after.clear();
+            if (pool == &own_pool) own_pool.next_frame();
+            compiled = false;
+        }
+
+
+        // resource resolution inside pass callbacks
+        texture& get_texture(graph_resource res) {
+            return texture_slots[resources[res.index].slot];
+        }
+
+        buffer& get_buffer(graph_resource res) {
+            const resource_node& node = resources[res.index];
+            return node.imported ? buffer_slots[node.slot] : *arena;
+        }
+
+        GLintptr buffer_offset(graph_resource res) const {
+            return resources[res.index].offset;
+        }
+
+        GLsizeiptr buffer_size(graph_resource res) const {
+            return resources[res.index].size;
+        }
+
+        // bind resource range (transient buffers live inside arena)
+        void bind_buffer(buffer_binding& binding, graph_resource res) {
+            const resource_node& node = resources[res.index];
+            if (node.imported) binding.bind(get_buffer(res));
+            else binding.bind_range(get_buffer(res), node.offset, GLsizei(node.size));
+        }
+
+        bool culled(const std::string& name) const {
+            for (auto& pass : passes) if (pass.name == name) return !pass.alive;
+            return false;
+        }
+
+        memory_barrier_bits barrier_before(const std::string& name) const {
+            for (auto& pass : passes) if (pass.name == name) return pass.barrier;
+            return memory_barrier_bits();
+        }
+
+        render_graph_stats stats() const {
+            return counters;
+        }
+    };
+
+
+    render_pass_builder& render_pass_builder::read(graph_resource res, resource_access access) {
+        graph->passes[pass].reads.push_back({ res.index, access });
+        graph->compiled = false; // usage changed after compile
+        return thisref;
+    }
+
+    render_pass_builder& render_pass_builder::write(graph_resource res, resource_access access) {
+        graph->passes[pass].writes.push_back({ res.index, access });
+        graph->compiled = false;
+        return thisref;
+    }
+
+    render_pass_builder& render_pass_builder::side_effect() {
+        graph->passes[pass].side_effect = true;
+        graph->compiled = false;
+        return thisref;
+    }
+
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "buffer.hpp"
+#include "texture.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace NS_NAME {
+
+    // contiguous unit range of one binding kind, units between set ones are left as bound
+    template<class T>
+    struct binding_range {
+        GLuint first = 0;
+        std::vector<T> slots;
+        std::vector<bool> used; // set by table
+
+        void set(GLuint unit, const T& value) {
+            if (slots.empty()) first = unit;
+            if (unit < first) {
+                slots.insert(slots.begin(), first - unit, T());
+                used.insert(used.begin(), first - unit, false);
+                first = unit;
+            }
+            if (unit - first >= slots.size()) {
+                slots.resize(unit - first + 1, T());
+                used.resize(unit - first + 1, false);
+            }
+            slots[unit - first] = value;
+            used[unit - first] = true;
+        }
+    };
+
+    struct buffer_range_slot {
+        GLuint name = 0;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+
+        bool operator!=(const buffer_range_slot& o) const {
+            return name != o.name || offset != o.offset || size != o.size;
+        }
+    };
+
+
+    // descriptor set like group of bindings, applied with multi-bind calls (see resource_bindings)
+    // objects are referenced by name and must outlive table use
+    class resource_table {
+    protected:
+        friend class _resource_bindings;
+        binding_range<GLuint> textures;
+        binding_range<GLuint> samplers;
+        binding_range<GLuint> images;
+        binding_range<buffer_range_slot> uniform_buffers;
+        binding_range<buffer_range_slot> storage_buffers;
+
+        static buffer_range_slot slot_of(buffer& buf, GLintptr offset, GLsizeiptr size) {
+            if (!size) {
+                GLint64 bytes = 0;
+                glGetNamedBufferParameteri64v(buf, GL_BUFFER_SIZE, &bytes);
+                size = GLsizeiptr(bytes) - offset;
+            }
+            return { GLuint(buf), offset, size };
+        }
+
+    public:
+        resource_table& texture(GLuint unit, NS_NAME::texture& tex) {
+            textures.set(unit, tex);
+            return thisref;
+        }
+
+        resource_table& sampler(GLuint unit, NS_NAME::sampler& sam) {
+            samplers.set(unit, sam);
+            return thisref;
+        }
+
+        // texture and sampler on same unit
+        resource_table& combined(GLuint unit, NS_NAME::texture& tex, NS_NAME::sampler& sam) {
+            textures.set(unit, tex);
+            samplers.set(unit, sam);
+            return thisref;
+        }
+
+        // multi-bind binds level 0, all layers, read write, texture internal format
+        resource_table& image(GLuint unit, NS_NAME::texture& tex) {
+            images.set(unit, tex);
+            return thisref;
+        }
+
+        // size 0 is rest of buffer (queried once here)
+        resource_table& uniform_buffer(GLuint index, buffer& buf, GLintptr offset = 0, GLsizeiptr size = 0) {
+            uniform_buffers.set(index, slot_of(buf, offset, size));
+            return thisref;
+        }
+
+        resource_table& storage_buffer(GLuint index, buffer& buf, GLintptr offset = 0, GLsizeiptr size = 0) {
+            storage_buffers.set(index, slot_of(buf, offset, size));
+            return thisref;
+        }
+
+        // unbinds unit on apply
+        resource_table& clear_texture(GLuint unit) {
+            textures.set(unit, 0);
+            samplers.set(unit, 0);
+            return thisref;
+        }
+
+        void apply();
+    };
+
+
+    struct resource_binding_stats {
+        uint64_t applies = 0;
+        uint64_t calls = 0;    // multi-bind calls issued
+        uint64_t bindings = 0; // units sent in those calls
+        uint64_t skipped = 0;  // units already bound
+    };
+
+
+    // shadow of bound units, applies tables by re-issuing only changed runs
+    // single unit binds (texture_binding, image, buffer_binding) between applies need invalidate()
+    class _resource_bindings {
+    protected:
+        template<class T>
+        struct shadow {
+            std::vector<T> bound;
+            std::vector<bool> known;
+
+            bool same(GLuint unit, const T& value) const {
+                return unit < bound.size() && known[unit] && !(bound[unit] != value);
+            }
+
+            void store(GLuint unit, const T& value) {
+                if (unit >= bound.size()) {
+                    bound.resize(unit + 1, T());
+                    known.resize(unit + 1, false);
+                }
+                bound[unit] = value;
+                known[unit] = true;
+            }
+
+            void forget() {
+                std::fill(known.begin(), known.end(), false);
+            }
+        };
+
+        shadow<GLuint> textures, samplers, images;
+        shadow<buffer_range_slot> uniform_buffers, storage_buffers;
+        std::vector<GLuint> names;
+        std::vector<GLintptr> offsets;
+        std::vector<GLsizeiptr> sizes;
+        resource_binding_stats counters;
+
+        // changed runs (unchanged gaps up to 2 units are merged), issue(first_unit, first_slot, count)
+        // runs never cover units the table did not set
+        template<class T, class F>
+        void diff(const binding_range<T>& range, shadow<T>& state, F issue) {
+            const GLuint count = GLuint(range.slots.size());
+            GLuint i = 0;
+            while (i < count) {
+                if (!range.used[i]) { i++; continue; }
+                if (state.same(range.first + i, range.slots[i])) { counters.skipped++; i++; continue; }
+                GLuint end = i + 1, last = i;
+                while (end < count && range.used[end] && end - last <= 3) {
+                    if (!state.same(range.first + end, range.slots[end])) last = end;
+                    end++;
+                }
+                const GLuint run = last - i + 1;
+                issue(range.first + i, i, run);
+                for (GLuint k = i; k <= last; k++) state.store(range.first + k, range.slots[k]);
+                counters.calls++;
+                counters.bindings += run;
+                i = last + 1;
+            }
+        }
+
+        void buffers(GLenum target, const binding_range<buffer_range_slot>& range, shadow<buffer_range_slot>& state) {
+            diff(range, state, [&](GLuint unit, GLuint at, GLuint count) {
+                names.resize(count);
+                offsets.resize(count);
+                sizes.resize(count);
+                for (GLuint k = 0; k < count; k++) {
+                    const buffer_range_slot& s = range.slots[at + k];
+                    names[k] = s.name;
+                    offsets[k] = s.offset;
+                    sizes[k] = s.name ? s.size : 0;
+                }
+                glBindBuffersRange(target, unit, GLsizei(count), names.data(), offsets.data(), sizes.data());
+            });
+        }
+
+    public:
+        void apply(const resource_table& table) {
+            counters.applies++;
+            diff(table.textures, textures, [&](GLuint unit, GLuint at, GLuint count) {
+                glBindTextures(unit, GLsizei(count), table.textures.slots.data() + at);
+            });
+            diff(table.samplers, samplers, [&](GLuint unit, GLuint at, GLuint count) {
+                glBindSamplers(unit, GLsizei(count), table.samplers.slots.data() + at);
+            });
+            diff(table.images, images, [&](GLuint unit, GLuint at, GLuint count) {
+                glBindImageTextures(unit, GLsizei(count), table.images.slots.data() + at);
+            });
+            buffers(GL_UNIFORM_BUFFER, table.uniform_buffers, uniform_buffers);
+            buffers(GL_SHADER_STORAGE_BUFFER, table.storage_buffers, storage_buffers);
+        }
+
+        // bindings changed outside, next apply issues everything
+        void invalidate() {
+            textures.forget();
+            samplers.forget();
+            images.forget();
+            uniform_buffers.forget();
+            storage_buffers.forget();
+        }
+
+        resource_binding_stats stats() const {
+            return counters;
+        }
+    };
+
+    _resource_bindings resource_bindings;
+
+    void resource_table::apply() {
+        resource_bindings.apply(thisref);
+    }
+
+};
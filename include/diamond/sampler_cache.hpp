@@ -0,0 +1,170 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "texture.hpp"
+#include <memory>
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+namespace NS_NAME {
+
+    // compact sampler parameters, equal descriptors share one sampler
+    struct sampler_desc {
+        GLenum min_filter = GL_LINEAR_MIPMAP_LINEAR;
+        GLenum mag_filter = GL_LINEAR;
+        GLenum wrap_s = GL_REPEAT;
+        GLenum wrap_t = GL_REPEAT;
+        GLenum wrap_r = GL_REPEAT;
+        GLenum compare_mode = GL_NONE;
+        GLenum compare_func = GL_LEQUAL;
+        float max_anisotropy = 1.f;
+        float lod_bias = 0.f;
+        float min_lod = -1000.f;
+        float max_lod = 1000.f;
+        glm::vec4 border_color = glm::vec4(0.f);
+
+        sampler_desc& filter(GLenum min, GLenum mag) {
+            min_filter = min;
+            mag_filter = mag;
+            return thisref;
+        }
+
+        sampler_desc& wrap(GLenum mode) {
+            wrap_s = wrap_t = wrap_r = mode;
+            return thisref;
+        }
+
+        sampler_desc& anisotropy(float value) {
+            max_anisotropy = value;
+            return thisref;
+        }
+
+        // depth comparison (shadow samplers)
+        sampler_desc& compare(GLenum func = GL_LEQUAL) {
+            compare_mode = GL_COMPARE_REF_TO_TEXTURE;
+            compare_func = func;
+            return thisref;
+        }
+
+        bool operator==(const sampler_desc& o) const {
+            return std::memcmp(this, &o, sizeof(sampler_desc)) == 0;
+        }
+
+        static sampler_desc nearest_clamp() {
+            return sampler_desc().filter(GL_NEAREST, GL_NEAREST).wrap(GL_CLAMP_TO_EDGE);
+        }
+
+        static sampler_desc linear_clamp() {
+            return sampler_desc().filter(GL_LINEAR, GL_LINEAR).wrap(GL_CLAMP_TO_EDGE);
+        }
+
+        static sampler_desc trilinear_repeat(float anisotropy = 1.f) {
+            return sampler_desc().anisotropy(anisotropy);
+        }
+
+        static sampler_desc shadow() {
+            return sampler_desc().filter(GL_LINEAR, GL_LINEAR).wrap(GL_CLAMP_TO_EDGE).compare();
+        }
+    };
+
+    static_assert(sizeof(sampler_desc) == 15 * 4, "sampler_desc must stay padding free (compared bytewise)");
+
+    struct sampler_desc_hash {
+        size_t operator()(const sampler_desc& d) const {
+            uint32_t words[sizeof(sampler_desc) / 4];
+            std::memcpy(words, &d, sizeof(words));
+            uint64_t h = 14695981039346656037ull;
+            for (uint32_t w : words) {
+                h ^= w;
+                h *= 1099511628211ull;
+            }
+            return size_t(h);
+        }
+    };
+
+
+    struct sampler_cache_stats {
+        size_t samplers = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+
+    // one shared sampler per distinct descriptor, returned samplers must not be modified
+    class sampler_cache {
+    protected:
+        std::unordered_map<sampler_desc, std::shared_ptr<sampler>, sampler_desc_hash> table;
+        sampler_cache_stats counters;
+        float anisotropy_limit = 0.f;
+
+        sampler_desc normalize(sampler_desc desc) {
+            if (anisotropy_limit <= 0.f) {
+                anisotropy_limit = 1.f;
+                glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &anisotropy_limit);
+            }
+            desc.max_anisotropy = std::min(std::max(desc.max_anisotropy, 1.f), std::max(anisotropy_limit, 1.f));
+            if (desc.compare_mode == GL_NONE) desc.compare_func = GL_LEQUAL;
+            return desc;
+        }
+
+    public:
+        std::shared_ptr<sampler> get(const sampler_desc& requested) {
+            const sampler_desc desc = normalize(requested);
+            auto found = table.find(desc);
+            if (found != table.end()) {
+                counters.hits++;
+                return found->second;
+            }
+
+            counters.misses++;
+            auto sam = std::make_shared<sampler>();
+            sam->parameter_val<int>(GL_TEXTURE_MIN_FILTER, desc.min_filter);
+            sam->parameter_val<int>(GL_TEXTURE_MAG_FILTER, desc.mag_filter);
+            sam->parameter_val<int>(GL_TEXTURE_WRAP_S, desc.wrap_s);
+            sam->parameter_val<int>(GL_TEXTURE_WRAP_T, desc.wrap_t);
+            sam->parameter_val<int>(GL_TEXTURE_WRAP_R, desc.wrap_r);
+            sam->parameter_val<int>(GL_TEXTURE_COMPARE_MODE, desc.compare_mode);
+            sam->parameter_val<int>(GL_TEXTURE_COMPARE_FUNC, desc.compare_func);
+            sam->parameter_val<float>(GL_TEXTURE_MAX_ANISOTROPY, desc.max_anisotropy);
+            sam->parameter_val<float>(GL_TEXTURE_LOD_BIAS, desc.lod_bias);
+            sam->parameter_val<float>(GL_TEXTURE_MIN_LOD, desc.min_lod);
+            sam->parameter_val<float>(GL_TEXTURE_MAX_LOD, desc.max_lod);
+            glSamplerParameterfv(*sam, GL_TEXTURE_BORDER_COLOR, &desc.border_color[0]);
+            table.emplace(desc, sam);
+            return sam;
+        }
+
+        // drops samplers referenced only by cache, returns count
+        size_t purge_unused() {
+            size_t count = 0;
+            for (auto it = table.begin(); it != table.end();) {
+                if (it->second.use_count() == 1) { it = table.erase(it); count++; }
+                else it++;
+            }
+            return count;
+        }
+
+        void clear() {
+            table.clear();
+        }
+
+        size_t size() const {
+            return table.size();
+        }
+
+        sampler_cache_stats stats() const {
+            sampler_cache_stats st = counters;
+            st.samplers = table.size();
+            return st;
+        }
+    };
+
+    // shared process-wide cache (GL thread)
+    sampler_cache& default_sampler_cache() {
+        static sampler_cache cache;
+        return cache;
+    }
+
+};
@@ -0,0 +1,347 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "program.hpp"
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <sstream>
+#include <cstring>
+#include <cctype>
+#include <cstdint>
+
+namespace NS_NAME {
+
+    // sorted defines, equal sets give equal keys
+    class shader_define_set {
+    protected:
+        std::map<std::string, std::string> values;
+
+    public:
+        shader_define_set() {}
+        shader_define_set(std::initializer_list<std::pair<const std::string, std::string>> defines) : values(defines) {}
+
+        shader_define_set& set(const std::string& name, const std::string& value = "1") {
+            values[name] = value;
+            return thisref;
+        }
+
+        shader_define_set& set(const std::string& name, int value) {
+            return this->set(name, std::to_string(value));
+        }
+
+        shader_define_set& unset(const std::string& name) {
+            values.erase(name);
+            return thisref;
+        }
+
+        const std::map<std::string, std::string>& get() const {
+            return values;
+        }
+
+        std::string key() const {
+            std::string k;
+            for (auto& v : values) {
+                k += v.first;
+                k += '=';
+                k += v.second;
+                k += ';';
+            }
+            return k;
+        }
+
+        // #define lines, only names used in source when given (unused flags do not split variants)
+        std::string directives(const std::string * source = nullptr) const {
+            std::string text;
+            for (auto& v : values) {
+                if (source && !mentions(*source, v.first)) continue;
+                text += "#define " + v.first + " " + v.second + "\n";
+            }
+            return text;
+        }
+
+        static bool mentions(const std::string& source, const std::string& name) {
+            auto ident = [](char c) { return std::isalnum((unsigned char)c) || c == '_'; };
+            for (size_t p = source.find(name); p != std::string::npos; p = source.find(name, p + 1)) {
+                const bool before = p == 0 || !ident(source[p - 1]);
+                const bool after = p + name.size() >= source.size() || !ident(source[p + name.size()]);
+                if (before && after) return true;
+            }
+            return false;
+        }
+    };
+
+
+    // expands #include "name" / <name> from registered files or loader, each file once per shader
+    class shader_preprocessor {
+    public:
+        using loader_fn = std::function<bool(const std::string& name, std::string& text)>;
+
+    protected:
+        std::unordered_map<std::string, std::string> files;
+        loader_fn loader;
+        std::vector<std::string> names; // #line source numbers
+
+        bool load(const std::string& name, std::string& text) {
+            auto found = files.find(name);
+            if (found != files.end()) { text = found->second; return true; }
+            if (loader && loader(name, text)) { files.emplace(name, text); return true; }
+            return false;
+        }
+
+        GLuint file_index(const std::string& name) {
+            for (size_t i = 0; i < names.size(); i++) if (names[i] == name) return GLuint(i);
+            names.push_back(name);
+            return GLuint(names.size() - 1);
+        }
+
+        static bool parse_include(const std::string& line, std::string& name) {
+            size_t p = line.find_first_not_of(" \t");
+            if (p == std::string::npos || line[p] != '#') return false;
+            p = line.find_first_not_of(" \t", p + 1);
+            if (p == std::string::npos || line.compare(p, 7, "include") != 0) return false;
+            const size_t open = line.find_first_of("\"<", p + 7);
+            if (open == std::string::npos) return false;
+            const size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+            if (close == std::string::npos) return false;
+            name = line.substr(open + 1, close - open - 1);
+            return true;
+        }
+
+        static bool is_directive(const std::string& line, const char * directive) {
+            size_t p = line.find_first_not_of(" \t");
+            if (p == std::string::npos || line[p] != '#') return false;
+            p = line.find_first_not_of(" \t", p + 1);
+            return p != std::string::npos && line.compare(p, std::strlen(directive), directive) == 0;
+        }
+
+        bool expand(const std::string& name, std::set<std::string>& included, std::vector<std::string>& stack, std::string& out, std::string& error) {
+            if (!included.insert(name).second) return true; // also breaks include cycles
+            std::string text;
+            if (!load(name, text)) {
+                error = "cannot open " + name + (stack.empty() ? "" : " (included from " + stack.back() + ")");
+                return false;
+            }
+            const GLuint index = file_index(name);
+            if (!stack.empty()) out += "#line 1 " + std::to_string(index) + "\n";
+            stack.push_back(name);
+            std::istringstream lines(text);
+            std::string line, include;
+            size_t number = 0;
+            while (std::getline(lines, line)) {
+                number++;
+                if (parse_include(line, include)) {
+                    if (!expand(include, included, stack, out, error)) return false;
+                    out += "#line " + std::to_string(number + 1) + " " + std::to_string(index) + "\n";
+                } else if (is_directive(line, "pragma") && line.find("once") != std::string::npos) {
+                    out += "\n";
+                } else {
+                    out += line;
+                    out += '\n';
+                }
+            }
+            stack.pop_back();
+            return true;
+        }
+
+    public:
+        // registered files take precedence over loader
+        void add_file(const std::string& name, const std::string& text) {
+            files[name] = text;
+        }
+
+        // e.g. reading from shader directory
+        void set_loader(loader_fn fn) {
+            loader = fn;
+        }
+
+        bool has_file(const std::string& name) {
+            std::string text;
+            return load(name, text);
+        }
+
+        // defines are placed after #version (which must be first line of root)
+        bool process(const std::string& root, const shader_define_set& defines, std::string& out, std::string& error) {
+            std::string body;
+            std::set<std::string> included;
+            std::vector<std::string> stack;
+            out.clear();
+            if (!expand(root, included, stack, body, error)) return false;
+
+            size_t start = 0;
+            const size_t first_end = body.find('\n');
+            const std::string first = body.substr(0, first_end);
+            if (is_directive(first, "version")) {
+                out = first + "\n";
+                start = first_end + 1;
+            }
+            out += defines.directives(&body);
+            out += "#line " + std::to_string(start ? 2 : 1) + " " + std::to_string(file_index(root)) + "\n";
+            out.append(body, std::min(start, body.size()), std::string::npos);
+            return true;
+        }
+
+        // file name of #line source number (compile errors)
+        const std::string& file_name(GLuint index) const {
+            return names[index];
+        }
+    };
+
+
+    struct shader_variant_stats {
+        uint64_t requests = 0;
+        uint64_t variants = 0;     // distinct define sets requested
+        uint64_t compiles = 0;     // GLSL programs compiled
+        uint64_t deduplicated = 0; // variants sharing compiled source
+        uint64_t specialized = 0;  // SPIR-V programs specialized
+    };
+
+
+    // lazily compiled separable stage programs keyed by (stage, file, defines), for program_pipeline_cache
+    // SPIR-V modules serve variants whose defines all map to specialization constants
+    class shader_variants {
+    protected:
+        struct spirv_module {
+            std::vector<GLchar> binary;
+            std::map<std::string, GLuint> constants; // define name to constant id
+            std::string entry_point;
+        };
+
+        shader_preprocessor pp;
+        std::map<std::pair<GLenum, std::string>, spirv_module> modules;
+        std::unordered_map<std::string, std::shared_ptr<program>> variants;
+        std::unordered_map<size_t, std::vector<std::pair<std::string, std::shared_ptr<program>>>> by_source;
+        std::string last_error;
+        shader_variant_stats counters;
+
+        static size_t hash_text(const std::string& text) {
+            uint64_t h = 14695981039346656037ull; // FNV-1a
+            for (unsigned char c : text) {
+                h ^= c;
+                h *= 1099511628211ull;
+            }
+            return size_t(h);
+        }
+
+        static bool parse_constant(const std::string& value, GLuint& bits) {
+            if (value == "true") { bits = 1; return true; }
+            if (value == "false") { bits = 0; return true; }
+            char * end = nullptr;
+            if (value.find_first_of(".eEf") != std::string::npos && value.find("0x") == std::string::npos) {
+                const float f = std::strtof(value.c_str(), &end);
+                if (end == value.c_str() || (*end && *end != 'f')) return false;
+                std::memcpy(&bits, &f, 4);
+                return true;
+            }
+            const long long v = std::strtoll(value.c_str(), &end, 0);
+            if (end == value.c_str() || *end) return false;
+            bits = GLuint(v);
+            return true;
+        }
+
+        static bool linked(program& prog, std::string& error) {
+            GLint status = 0;
+            prog.get<GLint>(GL_LINK_STATUS, &status);
+            if (!status) error = prog.info_log();
+            return status != 0;
+        }
+
+        std::shared_ptr<program> specialize(GLenum stage, const spirv_module& module, const shader_define_set& defines) {
+            std::vector<GLuint> indices, values;
+            for (auto& d : defines.get()) {
+                auto found = module.constants.find(d.first);
+                GLuint bits = 0;
+                if (found == module.constants.end() || !parse_constant(d.second, bits)) return nullptr;
+                indices.push_back(found->second);
+                values.push_back(bits);
+            }
+
+            shader shad(stage);
+            shad.binary(module.binary);
+            shad.specialize(module.entry_point, indices, values.data());
+            GLint compiled = 0;
+            shad.get<GLint>(GL_COMPILE_STATUS, &compiled);
+            if (!compiled) {
+                last_error = shad.info_log();
+                return nullptr;
+            }
+
+            auto prog = std::make_shared<program>();
+            glProgramParameteri(*prog, GL_PROGRAM_SEPARABLE, GL_TRUE);
+            prog->attach(shad);
+            prog->link();
+            glDetachShader(*prog, shad);
+            if (!linked(*prog, last_error)) return nullptr;
+            counters.specialized++;
+            return prog;
+        }
+
+    public:
+        shader_preprocessor& preprocessor() {
+            return pp;
+        }
+
+        // module for stage and file name, constants map define names to specialization constant ids
+        void add_spirv(GLenum stage, const std::string& name, const std::vector<GLchar>& binary, const std::map<std::string, GLuint>& constants, const std::string& entry_point = "main") {
+            modules[{ stage, name }] = { binary, constants, entry_point };
+        }
+
+        // compiled on first request, null when it fails (see error), failures are kept until clear()
+        std::shared_ptr<program> get(GLenum stage, const std::string& name, const shader_define_set& defines = shader_define_set()) {
+            counters.requests++;
+            const std::string key = std::to_string(stage) + ":" + name + ":" + defines.key();
+            auto found = variants.find(key);
+            if (found != variants.end()) return found->second;
+
+            std::shared_ptr<program> prog;
+            auto module = modules.find({ stage, name });
+            if (module != modules.end()) prog = specialize(stage, module->second, defines);
+
+            if (!prog && pp.has_file(name)) {
+                std::string text;
+                if (pp.process(name, defines, text, last_error)) {
+                    const size_t h = hash_text(text) ^ size_t(stage);
+                    for (auto& entry : by_source[h]) {
+                        if (entry.first == text) { prog = entry.second; counters.deduplicated++; break; }
+                    }
+                    if (!prog) {
+                        prog = std::make_shared<program>(stage, text);
+                        counters.compiles++;
+                        if (linked(*prog, last_error)) by_source[h].emplace_back(text, prog);
+                        else prog = nullptr;
+                    }
+                }
+            }
+            if (!prog && module == modules.end() && !pp.has_file(name)) last_error = "no source or module for " + name;
+            if (prog) counters.variants++;
+            variants.emplace(key, prog); // failures too, until clear()
+            return prog;
+        }
+
+        // preprocessed GLSL of variant (debugging)
+        std::string source(const std::string& name, const shader_define_set& defines = shader_define_set()) {
+            std::string text, error;
+            if (!pp.process(name, defines, text, error)) return std::string();
+            return text;
+        }
+
+        const std::string& error() const {
+            return last_error;
+        }
+
+        shader_variant_stats stats() const {
+            return counters;
+        }
+
+        // programs stay alive while referenced
+        void clear() {
+            variants.clear();
+            by_source.clear();
+        }
+    };
+
+};
@@ -0,0 +1,279 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "buffer.hpp"
+#include "texture.hpp"
+#include "program.hpp"
+#include "vertex_array.hpp"
+#include "command.hpp"
+#include "managment.hpp"
+#include "sync.hpp"
+#include "sampler_cache.hpp"
+#include "pipeline_state.hpp"
+#include "resource_table.hpp"
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+
+namespace NS_NAME {
+
+    namespace sprite_batch_source {
+
+        const char * vertex = R"(#version 460 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 uvw;
+layout(location = 2) in vec4 color;
+uniform mat4 projection;
+out gl_PerVertex { vec4 gl_Position; };
+layout(location = 0) out vec3 f_uvw;
+layout(location = 1) out vec4 f_color;
+void main() {
+    f_uvw = uvw;
+    f_color = color;
+    gl_Position = projection * vec4(position, 1.0);
+}
+)";
+
+        // negative layer is untextured
+        const char * fragment = R"(#version 460 core
+layout(binding = 0) uniform sampler2DArray atlas;
+layout(location = 0) in vec3 f_uvw;
+layout(location = 1) in vec4 f_color;
+layout(location = 0) out vec4 out_color;
+void main() {
+    out_color = f_uvw.z < 0.0 ? f_color : f_color * texture(atlas, f_uvw);
+}
+)";
+    };
+
+
+    // 28 bytes, color is rgba8 (see sprite_batcher::rgba)
+    struct batch_vertex {
+        glm::vec3 position;
+        glm::vec3 uvw; // uv and texture array layer, layer < 0 untextured
+        uint32_t color;
+    };
+
+
+    struct sprite_batch_stats {
+        uint64_t primitives = 0;
+        uint64_t draws = 0;
+        uint64_t state_breaks = 0;    // flushes caused by mode, texture, clip or projection change
+        uint64_t capacity_breaks = 0; // flushes caused by full window
+    };
+
+
+    // immediate mode quads, triangles and lines (UI, debug) written straight to persistent mapped vertex and index rings
+    // primitives are merged until mode, texture array, clip rect or projection changes, layers of one array never break batch
+    // draws use caller blend and depth state, program pipeline, vertex array, unit 0 and scissor are left changed
+    class sprite_batcher {
+    protected:
+        ring_buffer vertex_ring;
+        ring_buffer index_ring;
+        program vs, fs;
+        program_pipeline ppl;
+        vertex_array vao;
+        std::shared_ptr<sampler> sam;
+        GLuint window; // vertices per batch (16 bit indices)
+
+        // current batch
+        ring_buffer::allocation vtx, idx;
+        batch_vertex * vertices = nullptr;
+        uint16_t * indices = nullptr;
+        GLuint vertex_count = 0, index_count = 0;
+        bool open = false;
+        bool textured = false; // batch samples array_texture
+        _mode * mode = &draw_mode::triangles;
+        GLuint array_texture = 0;
+        glm::ivec4 clip_rect = glm::ivec4(0);
+        bool clipped = false;
+
+        sprite_batch_stats counters;
+
+        // flushes when primitive of mode and texture (0 untextured) does not fit current state
+        void prepare(_mode& m, GLuint tex) {
+            const bool texture_change = tex && textured && tex != array_texture;
+            if (index_count && (&m != mode || texture_change)) {
+                counters.state_breaks++;
+                this->flush();
+            }
+            mode = &m;
+            if (tex) array_texture = tex;
+        }
+
+        // room for vcount vertices and icount indices, returns first vertex of primitive
+        uint16_t reserve(GLuint vcount, GLuint icount) {
+            if (open && (vertex_count + vcount > window || index_count + icount > window * 3 / 2)) {
+                counters.capacity_breaks++;
+                this->flush();
+            }
+            if (!open) {
+                vtx = vertex_ring.allocate(GLsizeiptr(window) * sizeof(batch_vertex), sizeof(batch_vertex));
+                idx = index_ring.allocate(GLsizeiptr(window) * 3 / 2 * sizeof(uint16_t), sizeof(uint16_t));
+                vertices = reinterpret_cast<batch_vertex*>(vtx.data);
+                indices = reinterpret_cast<uint16_t*>(idx.data);
+                open = true;
+            }
+            counters.primitives++;
+            return uint16_t(vertex_count);
+        }
+
+        void vertex(const glm::vec3& position, const glm::vec2& uv, float layer, uint32_t color) {
+            vertices[vertex_count++] = { position, glm::vec3(uv, layer), color };
+        }
+
+    public:
+        // capacity is vertices in flight over frames (indices get 3/2 of it), window is max vertices per draw
+        sprite_batcher(GLuint capacity = 1 << 18, GLuint window = 16384) :
+            vertex_ring(GLsizeiptr(capacity) * sizeof(batch_vertex)),
+            index_ring(GLsizeiptr(capacity) * 3 / 2 * sizeof(uint16_t)),
+            vs(GL_VERTEX_SHADER, std::string(sprite_batch_source::vertex)),
+            fs(GL_FRAGMENT_SHADER, std::string(sprite_batch_source::fragment)),
+            window(std::min(std::min(window, 65536u), capacity / 2)) {
+            ppl.use_stages(GL_VERTEX_SHADER_BIT, vs);
+            ppl.use_stages(GL_FRAGMENT_SHADER_BIT, fs);
+
+            vao.vertex_buffer(0, vertex_ring.get(), 0, sizeof(batch_vertex));
+            vao.element_buffer(index_ring.get());
+            auto position = vao.create_attribute(0);
+            position.attrib_format(3, GL_FLOAT, GL_FALSE, offsetof(batch_vertex, position));
+            position.binding(0);
+            auto uvw = vao.create_attribute(1);
+            uvw.attrib_format(3, GL_FLOAT, GL_FALSE, offsetof(batch_vertex, uvw));
+            uvw.binding(0);
+            auto color = vao.create_attribute(2);
+            color.attrib_format(4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(batch_vertex, color));
+            color.binding(0);
+
+            sam = default_sampler_cache().get(sampler_desc::linear_clamp());
+            this->set_projection(glm::mat4(1.f));
+        }
+
+        static uint32_t rgba(const glm::vec4& color) {
+            return glm::packUnorm4x8(color);
+        }
+
+        // e.g. glm::ortho(0, width, height, 0) for UI
+        void set_projection(const glm::mat4& projection) {
+            if (index_count) {
+                counters.state_breaks++;
+                this->flush();
+            }
+            vs.get_uniform<glm::mat4>("projection") = projection;
+        }
+
+        // GL_TEXTURE_2D_ARRAY bound to unit 0 of later textured primitives
+        void set_texture(texture& array) {
+            this->prepare(*mode, array);
+        }
+
+        void set_sampler(std::shared_ptr<sampler> s) {
+            if (index_count && s != sam) {
+                counters.state_breaks++;
+                this->flush();
+            }
+            sam = s;
+        }
+
+        // window space scissor (x, y, width, height)
+        void set_clip(const glm::ivec4& rect) {
+            if (clipped && rect == clip_rect) return;
+            if (index_count) {
+                counters.state_breaks++;
+                this->flush();
+            }
+            clip_rect = rect;
+            clipped = true;
+        }
+
+        void clear_clip() {
+            if (!clipped) return;
+            if (index_count) {
+                counters.state_breaks++;
+                this->flush();
+            }
+            clipped = false;
+        }
+
+        // axis aligned quad, uv is (u0, v0, u1, v1), layer < 0 untextured
+        void quad(const glm::vec2& min, const glm::vec2& max, uint32_t color, const glm::vec4& uv = glm::vec4(0.f, 0.f, 1.f, 1.f), float layer = -1.f) {
+            const glm::vec3 corners[4] = { glm::vec3(min.x, min.y, 0.f), glm::vec3(max.x, min.y, 0.f), glm::vec3(max.x, max.y, 0.f), glm::vec3(min.x, max.y, 0.f) };
+            const glm::vec2 uvs[4] = { glm::vec2(uv.x, uv.y), glm::vec2(uv.z, uv.y), glm::vec2(uv.z, uv.w), glm::vec2(uv.x, uv.w) };
+            this->quad(corners, uvs, color, layer);
+        }
+
+        // corners in winding order
+        void quad(const glm::vec3 corners[4], const glm::vec2 uvs[4], uint32_t color, float layer = -1.f) {
+            this->prepare(draw_mode::triangles, 0);
+            const uint16_t first = this->reserve(4, 6);
+            for (int i = 0; i < 4; i++) this->vertex(corners[i], uvs[i], layer, color);
+            if (layer >= 0.f) textured = true;
+            const uint16_t order[6] = { 0, 1, 2, 0, 2, 3 };
+            for (uint16_t o : order) indices[index_count++] = uint16_t(first + o);
+        }
+
+        void triangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, uint32_t color) {
+            this->prepare(draw_mode::triangles, 0);
+            const uint16_t first = this->reserve(3, 3);
+            this->vertex(a, glm::vec2(0.f), -1.f, color);
+            this->vertex(b, glm::vec2(0.f), -1.f, color);
+            this->vertex(c, glm::vec2(0.f), -1.f, color);
+            for (uint16_t i = 0; i < 3; i++) indices[index_count++] = uint16_t(first + i);
+        }
+
+        void line(const glm::vec3& a, const glm::vec3& b, uint32_t color) {
+            this->prepare(draw_mode::lines, 0);
+            const uint16_t first = this->reserve(2, 2);
+            this->vertex(a, glm::vec2(0.f), -1.f, color);
+            this->vertex(b, glm::vec2(0.f), -1.f, color);
+            indices[index_count++] = first;
+            indices[index_count++] = uint16_t(first + 1);
+        }
+
+        // draws pending primitives as one indexed draw
+        void flush() {
+            if (!open) return;
+            vertex_ring.shrink(vtx, GLsizeiptr(vertex_count) * sizeof(batch_vertex));
+            index_ring.shrink(idx, GLsizeiptr(index_count) * sizeof(uint16_t));
+            open = false;
+            if (!index_count) return;
+
+            glUseProgram(0);
+            managment.bind_program_pipeline(ppl);
+            managment.bind_vertex_array(vao);
+            if (array_texture) glBindTextureUnit(0, array_texture);
+            glBindSampler(0, sam ? GLuint(*sam) : 0);
+            if (clipped) {
+                glEnable(GL_SCISSOR_TEST);
+                glScissor(clip_rect.x, clip_rect.y, clip_rect.z, clip_rect.w);
+            } else {
+                glDisable(GL_SCISSOR_TEST);
+            }
+            pipeline_states.invalidate();
+            resource_bindings.invalidate();
+
+            const GLvoid * first_index = reinterpret_cast<const GLvoid*>(idx.offset);
+            commands.draw_elements_base_instance(*mode, GLsizei(index_count), GL_UNSIGNED_SHORT, first_index, 1, GLint(vtx.offset / GLintptr(sizeof(batch_vertex))), 0);
+            counters.draws++;
+            vertex_count = 0;
+            index_count = 0;
+            textured = false;
+        }
+
+        // once per frame after last primitive, ring space is reused when GPU passed the fence
+        void end_frame() {
+            this->flush();
+            vertex_ring.fence();
+            index_ring.fence();
+        }
+
+        sprite_batch_stats stats() const {
+            return counters;
+        }
+
+        void reset_stats() {
+            counters = sprite_batch_stats();
+        }
+    };
+
+};
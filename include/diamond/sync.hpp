@@ -0,0 +1,169 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "buffer.hpp"
+#include <deque>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace NS_NAME {
+
+    // GPU fence (glFenceSync), signaled when preceding commands complete
+    class fence {
+    protected:
+        GLsync sync = nullptr;
+
+    public:
+        fence() {}
+        fence(fence&& another) : sync(another.sync) { another.sync = nullptr; }
+        fence(const fence&) = delete;
+
+        ~fence() {
+            this->release();
+        }
+
+        void release() {
+            if (sync) glDeleteSync(sync);
+            sync = nullptr;
+        }
+
+        // replaces previous fence
+        void insert() {
+            this->release();
+            sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+
+        // non-blocking test (no fence is signaled)
+        bool signaled() const {
+            if (!sync) return true;
+            const GLenum state = glClientWaitSync(sync, 0, 0);
+            return state == GL_ALREADY_SIGNALED || state == GL_CONDITION_SATISFIED;
+        }
+
+        // blocks up to timeout (nanoseconds), flushes so fence can signal
+        bool wait(GLuint64 timeout = GL_TIMEOUT_IGNORED) const {
+            if (!sync) return true;
+            const GLenum state = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+            return state == GL_ALREADY_SIGNALED || state == GL_CONDITION_SATISFIED;
+        }
+
+        // GPU side wait (other context)
+        void server_wait() const {
+            if (sync) glWaitSync(sync, 0, GL_TIMEOUT_IGNORED);
+        }
+
+        bool valid() const {
+            return sync != nullptr;
+        }
+
+        operator GLsync() const {
+            return sync;
+        }
+    };
+
+
+    // persistent coherent mapped buffer, sub-allocated as ring and guarded by fences
+    class ring_buffer {
+    public:
+        struct allocation {
+            uint8_t * data = nullptr;
+            GLintptr offset = 0;
+            GLsizeiptr size = 0;
+        };
+
+    protected:
+        struct range {
+            GLintptr begin;
+            GLintptr end;
+            std::shared_ptr<NS_NAME::fence> guard;
+        };
+
+        buffer buf;
+        uint8_t * mapped = nullptr;
+        GLsizeiptr capacity = 0;
+        GLintptr head = 0;
+        std::vector<range> pending; // allocated since last fence
+        std::deque<range> in_flight;
+        uint64_t stalls = 0;
+
+        static bool overlaps(const range& r, GLintptr begin, GLintptr end) {
+            return r.begin < end && begin < r.end;
+        }
+
+    public:
+        ring_buffer(GLsizeiptr capacity) : capacity(capacity) {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            buf.storage(capacity, nullptr, flags);
+            mapped = (uint8_t *)buf.map_range(0, capacity, flags);
+        }
+
+        ~ring_buffer() {
+            if (mapped) buf.unmap();
+        }
+
+        // size <= capacity, waits when region is still used by GPU
+        allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16) {
+            GLintptr offset = (head + alignment - 1) / alignment * alignment;
+            if (offset + size > capacity) offset = 0;
+            const GLintptr end = offset + size;
+
+            for (auto& r : pending) {
+                if (overlaps(r, offset, end)) { this->fence(); break; }
+            }
+
+            size_t last = SIZE_MAX;
+            for (size_t i = 0; i < in_flight.size(); i++) {
+                if (overlaps(in_flight[i], offset, end)) last = i;
+            }
+            if (last != SIZE_MAX) {
+                if (!in_flight[last].guard->signaled()) stalls++;
+                in_flight[last].guard->wait(); // fences signal in order
+                in_flight.erase(in_flight.begin(), in_flight.begin() + last + 1);
+            }
+            while (!in_flight.empty() && in_flight.front().guard->signaled()) in_flight.pop_front();
+
+            head = end;
+            if (!pending.empty() && offset >= pending.back().end && offset <= pending.back().end + alignment) pending.back().end = end;
+            else pending.push_back({ offset, end, nullptr });
+            return { mapped + offset, offset, size };
+        }
+
+        // returns unused tail of latest allocation (reserve then fill), size is bytes kept
+        void shrink(allocation& a, GLsizeiptr size) {
+            if (a.offset + a.size != head || size >= a.size) return;
+            head = a.offset + size;
+            a.size = size;
+            if (!pending.empty() && pending.back().end > head) {
+                pending.back().end = head;
+                if (pending.back().end <= pending.back().begin) pending.pop_back();
+            }
+        }
+
+        // after commands reading pending allocations (e.g. once per frame or upload batch)
+        void fence() {
+            if (pending.empty()) return;
+            auto guard = std::make_shared<NS_NAME::fence>();
+            guard->insert();
+            for (auto& r : pending) {
+                r.guard = guard;
+                in_flight.push_back(r);
+            }
+            pending.clear();
+        }
+
+        buffer& get() {
+            return buf;
+        }
+
+        GLsizeiptr size() const {
+            return capacity;
+        }
+
+        // allocations that had to wait for GPU
+        uint64_t stall_count() const {
+            return stalls;
+        }
+    };
+
+};
@@ -26,6 +26,10 @@ namespace NS_NAME {
         void subimage(glm::ivec2 offset, glm::uvec2 size, GLenum format, GLenum type, const GLvoid * pixels);
         void subimage(glm::ivec3 offset, glm::uvec3 size, GLenum format, GLenum type, const GLvoid * pixels);
 
+        void compressed_subimage(GLint offset, GLuint size, GLenum format, GLsizei imagesize, const GLvoid * data);
+        void compressed_subimage(glm::ivec2 offset, glm::uvec2 size, GLenum format, GLsizei imagesize, const GLvoid * data);
+        void compressed_subimage(glm::ivec3 offset, glm::uvec3 size, GLenum format, GLsizei imagesize, const GLvoid * data);
+
         void get_image_subdata(glm::ivec3 offset, glm::uvec3 size, GLenum format, GLenum type, GLenum buffersize, void *pixels) const;
 
         template<class T>
@@ -42,6 +46,10 @@ namespace NS_NAME {
             return *(this->get_parameter(pname, params));
         }
 
+        texture& get_texture() const {
+            return *gltex;
+        }
+
         operator GLuint() const {
             return level;
         }
@@ -54,9 +62,15 @@ namespace NS_NAME {
     class texture_builder {
     public:
         static void create(GLuint * heap, _texture_context& target);
+        static void create_n(GLsizei n, GLuint * heap, GLenum target){
+            glCreateTextures(target, n, heap);
+        }
         static void release(GLuint * heap){
             glDeleteTextures(1, heap);
         }
+        static void release_n(GLsizei n, const GLuint * heap){
+            glDeleteTextures(n, heap);
+        }
     };
 
 
@@ -152,6 +166,15 @@ namespace NS_NAME {
             glTextureStorage3D(thisref, levels, internalformat.internal(), size.x, size.y, size.z);
         }
 
+        // multisample storage (2D or 2D array)
+        void storage_multisample(GLsizei samples, const _internal_format& internalformat, glm::uvec2 size, GLboolean fixedsamplelocations = GL_TRUE) {
+            glTextureStorage2DMultisample(thisref, samples, internalformat.internal(), size.x, size.y, fixedsamplelocations);
+        }
+
+        void storage_multisample(GLsizei samples, const _internal_format& internalformat, glm::uvec3 size, GLboolean fixedsamplelocations = GL_TRUE) {
+            glTextureStorage3DMultisample(thisref, samples, internalformat.internal(), size.x, size.y, size.z, fixedsamplelocations);
+        }
+
 
         // subimage (accept GLM vector)
         void subimage(GLint level, glm::ivec3 offset, glm::uvec3 size, GLenum format, GLenum type, const GLvoid * pixels) {
@@ -167,6 +190,20 @@ namespace NS_NAME {
         }
 
 
+        // compressed subimage (format is compressed internal format, imagesize in bytes)
+        void compressed_subimage(GLint level, glm::ivec3 offset, glm::uvec3 size, GLenum format, GLsizei imagesize, const GLvoid * data) {
+            glCompressedTextureSubImage3D(thisref, level, offset.x, offset.y, offset.z, size.x, size.y, size.z, format, imagesize, data);
+        }
+
+        void compressed_subimage(GLint level, glm::ivec2 offset, glm::uvec2 size, GLenum format, GLsizei imagesize, const GLvoid * data) {
+            glCompressedTextureSubImage2D(thisref, level, offset.x, offset.y, size.x, size.y, format, imagesize, data);
+        }
+
+        void compressed_subimage(GLint level, GLint offset, GLsizei size, GLenum format, GLsizei imagesize, const GLvoid * data) {
+            glCompressedTextureSubImage1D(thisref, level, offset, size, format, imagesize, data);
+        }
+
+
         // simplified version of very hard function
         void copy_image_subdata(GLint srcLevel, glm::ivec3 srcOffset, texture& destination, GLint dstLevel, glm::ivec3 dstOffset, glm::uvec3 size) const;
 
@@ -221,6 +258,18 @@ namespace NS_NAME {
         gltex->subimage(thisref, offset, size, format, type, pixels);
     };
 
+    void texture_level::compressed_subimage(glm::ivec3 offset, glm::uvec3 size, GLenum format, GLsizei imagesize, const GLvoid * data) {
+        gltex->compressed_subimage(thisref, offset, size, format, imagesize, data);
+    };
+
+    void texture_level::compressed_subimage(glm::ivec2 offset, glm::uvec2 size, GLenum format, GLsizei imagesize, const GLvoid * data) {
+        gltex->compressed_subimage(thisref, offset, size, format, imagesize, data);
+    };
+
+    void texture_level::compressed_subimage(GLint offset, GLuint size, GLenum format, GLsizei imagesize, const GLvoid * data) {
+        gltex->compressed_subimage(thisref, offset, size, format, imagesize, data);
+    };
+
     void texture_level::get_image_subdata(glm::ivec3 offset, glm::uvec3 size, GLenum format, GLenum type, GLenum buffersize, void *pixels) const {
         gltex->get_image_subdata((GLuint)thisref, offset, size, format, type, buffersize, pixels);
     }
@@ -251,11 +300,17 @@ namespace NS_NAME {
     class sampler_builder {
     public:
         static void create(GLuint * heap){
-            glCreateSamplers(1, heap);
+            if (!take_pooled_name<sampler_builder>(heap)) glCreateSamplers(1, heap);
+        }
+        static void create_n(GLsizei n, GLuint * heap, GLenum = 0){
+            glCreateSamplers(n, heap);
         }
         static void release(GLuint * heap){
             glDeleteSamplers(1, heap);
         }
+        static void release_n(GLsizei n, const GLuint * heap){
+            glDeleteSamplers(n, heap);
+        }
     };
 
 
@@ -393,7 +448,7 @@ namespace NS_NAME {
     
     
     void texture_builder::create(GLuint * heap, _texture_context& target){
-        glCreateTextures(target, 1, heap);
+        if (!take_pooled_name<texture_builder>(heap, target)) glCreateTextures(target, 1, heap);
     }
 
     void texture::copy_image_subdata(GLint srcLevel, glm::ivec3 srcOffset, texture& destination, GLint dstLevel, glm::ivec3 dstOffset, glm::uvec3 size) const {
@@ -407,6 +462,7 @@ namespace NS_NAME {
         for (intptr_t pt = 0; pt < n; pt++) {
             textures.push_back(texture(gltarget, objects + pt));
         }
+        delete[] objects;
         return std::move(textures);
     }
 
@@ -415,11 +471,13 @@ namespace NS_NAME {
     // texture targets
     namespace texture_target {
         _texture_context texture_cube(GL_TEXTURE_CUBE_MAP);
+        _texture_context texture_cube_array(GL_TEXTURE_CUBE_MAP_ARRAY);
         _texture_context texture_buffer(GL_TEXTURE_BUFFER);
         _texture_context texture1d(GL_TEXTURE_1D);
         _texture_context texture2d(GL_TEXTURE_2D);
         _texture_context texture3d(GL_TEXTURE_3D);
         _texture_context texture2d_msaa(GL_TEXTURE_2D_MULTISAMPLE);
+        _texture_context texture2d_msaa_array(GL_TEXTURE_2D_MULTISAMPLE_ARRAY);
         _texture_context texture1d_array(GL_TEXTURE_1D_ARRAY);
         _texture_context texture2d_array(GL_TEXTURE_2D_ARRAY);
     };
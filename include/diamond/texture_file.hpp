@@ -0,0 +1,536 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "enums.hpp"
+#include "texture.hpp"
+#include "parallel.hpp"
+#include "mapped_file.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstring>
+
+namespace NS_NAME {
+
+    // KTX2 supercompression schemes and their decoders (BasisLZ, scheme 1, needs transcoding and is rejected)
+    namespace supercompression {
+        const uint32_t none = 0;
+        const uint32_t zstd = 2;
+        const uint32_t zlib = 3;
+
+        // decoder must fill exactly dst_size bytes, false on corrupted input
+        using decoder = std::function<bool(const uint8_t * src, size_t src_size, uint8_t * dst, size_t dst_size)>;
+
+        std::map<uint32_t, decoder>& decoders() {
+            static std::map<uint32_t, decoder> table;
+            return table;
+        }
+
+        // no codec is bundled, application registers its own (e.g. libzstd, zlib)
+        void register_decoder(uint32_t scheme, decoder fn) {
+            decoders()[scheme] = std::move(fn);
+        }
+    };
+
+
+    // container pixel format with byte size of texel (or of 4x4 block)
+    struct file_format {
+        _internal_format format = _internal_format(GL_NONE, GL_NONE, GL_NONE);
+        GLsizei texel_bytes = 0;
+
+        file_format() {}
+        file_format(GLenum internal, GLenum format, GLenum type, GLsizei texel_bytes) : format(internal, format, type), texel_bytes(texel_bytes) {}
+
+        bool valid() const {
+            return format.internal() != GL_NONE && texel_bytes > 0;
+        }
+
+        // bytes of single layer of level
+        size_t image_size(glm::uvec3 extent) const {
+            if (format.compressed()) return size_t((extent.x + 3) / 4) * size_t((extent.y + 3) / 4) * size_t(extent.z) * size_t(texel_bytes);
+            return size_t(extent.x) * size_t(extent.y) * size_t(extent.z) * size_t(texel_bytes);
+        }
+    };
+
+
+    namespace file_formats {
+
+        // Vulkan format (KTX2)
+        file_format from_vk(uint32_t vk) {
+            switch (vk) {
+                case 9: return file_format(GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1);
+                case 10: return file_format(GL_R8_SNORM, GL_RED, GL_BYTE, 1);
+                case 13: return file_format(GL_R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, 1);
+                case 14: return file_format(GL_R8I, GL_RED_INTEGER, GL_BYTE, 1);
+                case 16: return file_format(GL_RG8, GL_RG, GL_UNSIGNED_BYTE, 2);
+                case 17: return file_format(GL_RG8_SNORM, GL_RG, GL_BYTE, 2);
+                case 20: return file_format(GL_RG8UI, GL_RG_INTEGER, GL_UNSIGNED_BYTE, 2);
+                case 21: return file_format(GL_RG8I, GL_RG_INTEGER, GL_BYTE, 2);
+                case 23: return file_format(GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, 3);
+                case 24: return file_format(GL_RGB8_SNORM, GL_RGB, GL_BYTE, 3);
+                case 29: return file_format(GL_SRGB8, GL_RGB, GL_UNSIGNED_BYTE, 3);
+                case 37: return file_format(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4);
+                case 38: return file_format(GL_RGBA8_SNORM, GL_RGBA, GL_BYTE, 4);
+                case 41: return file_format(GL_RGBA8UI, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, 4);
+                case 42: return file_format(GL_RGBA8I, GL_RGBA_INTEGER, GL_BYTE, 4);
+                case 43: return file_format(GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE, 4);
+                case 44: return file_format(GL_RGBA8, GL_BGRA, GL_UNSIGNED_BYTE, 4);
+                case 50: return file_format(GL_SRGB8_ALPHA8, GL_BGRA, GL_UNSIGNED_BYTE, 4);
+                case 70: return file_format(GL_R16, GL_RED, GL_UNSIGNED_SHORT, 2);
+                case 71: return file_format(GL_R16_SNORM, GL_RED, GL_SHORT, 2);
+                case 74: return file_format(GL_R16UI, GL_RED_INTEGER, GL_UNSIGNED_SHORT, 2);
+                case 75: return file_format(GL_R16I, GL_RED_INTEGER, GL_SHORT, 2);
+                case 76: return file_format(GL_R16F, GL_RED, GL_HALF_FLOAT, 2);
+                case 77: return file_format(GL_RG16, GL_RG, GL_UNSIGNED_SHORT, 4);
+                case 78: return file_format(GL_RG16_SNORM, GL_RG, GL_SHORT, 4);
+                case 81: return file_format(GL_RG16UI, GL_RG_INTEGER, GL_UNSIGNED_SHORT, 4);
+                case 82: return file_format(GL_RG16I, GL_RG_INTEGER, GL_SHORT, 4);
+                case 83: return file_format(GL_RG16F, GL_RG, GL_HALF_FLOAT, 4);
+                case 91: return file_format(GL_RGBA16, GL_RGBA, GL_UNSIGNED_SHORT, 8);
+                case 92: return file_format(GL_RGBA16_SNORM, GL_RGBA, GL_SHORT, 8);
+                case 95: return file_format(GL_RGBA16UI, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, 8);
+                case 96: return file_format(GL_RGBA16I, GL_RGBA_INTEGER, GL_SHORT, 8);
+                case 97: return file_format(GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, 8);
+                case 98: return file_format(GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, 4);
+                case 99: return file_format(GL_R32I, GL_RED_INTEGER, GL_INT, 4);
+                case 100: return file_format(GL_R32F, GL_RED, GL_FLOAT, 4);
+                case 101: return file_format(GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT, 8);
+                case 102: return file_format(GL_RG32I, GL_RG_INTEGER, GL_INT, 8);
+                case 103: return file_format(GL_RG32F, GL_RG, GL_FLOAT, 8);
+                case 104: return file_format(GL_RGB32UI, GL_RGB_INTEGER, GL_UNSIGNED_INT, 12);
+                case 105: return file_format(GL_RGB32I, GL_RGB_INTEGER, GL_INT, 12);
+                case 106: return file_format(GL_RGB32F, GL_RGB, GL_FLOAT, 12);
+                case 107: return file_format(GL_RGBA32UI, GL_RGBA_INTEGER, GL_UNSIGNED_INT, 16);
+                case 108: return file_format(GL_RGBA32I, GL_RGBA_INTEGER, GL_INT, 16);
+                case 109: return file_format(GL_RGBA32F, GL_RGBA, GL_FLOAT, 16);
+                case 131: return file_format(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_RGB, GL_UNSIGNED_BYTE, 8);
+                case 132: return file_format(GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, GL_RGB, GL_UNSIGNED_BYTE, 8);
+                case 133: return file_format(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_RGBA, GL_UNSIGNED_BYTE, 8);
+                case 134: return file_format(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, GL_RGBA, GL_UNSIGNED_BYTE, 8);
+                case 135: return file_format(GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, GL_RGBA, GL_UNSIGNED_BYTE, 16);
+                case 136: return file_format(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, GL_RGBA, GL_UNSIGNED_BYTE, 16);
+                case 137: return file_format(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_RGBA, GL_UNSIGNED_BYTE, 16);
+                case 138: return file_format(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, GL_RGBA, GL_UNSIGNED_BYTE, 16);
+                case 139: return file_format(GL_COMPRESSED_RED_RGTC1, GL_RED, GL_UNSIGNED_BYTE, 8);
+                case 140: return file_format(GL_COMPRESSED_SIGNED_RED_RGTC1, GL_RED, GL_BYTE, 8);
+                case 141: return file_format(GL_COMPRESSED_RG_RGTC2, GL_RG, GL_UNSIGNED_BYTE, 16);
+                case 142: return file_format(GL_COMPRESSED_SIGNED_RG_RGTC2, GL_RG, GL_BYTE, 16);
+                case 143: return file_format(GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, GL_RGB, GL_HALF_FLOAT, 16);
+                case 144: return file_format(GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT, GL_RGB, GL_HALF_FLOAT, 16);
+                case 145: return file_format(GL_COMPRESSED_RGBA_BPTC_UNORM, GL_RGBA, GL_UNSIGNED_BYTE, 16);
+                case 146: return file_format(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, GL_RGBA, GL_UNSIGNED_BYTE, 16);
+            }
+            return file_format();
+        }
+
+        // DXGI format (DDS with DX10 header)
+        file_format from_dxgi(uint32_t dxgi) {
+            switch (dxgi) {
+                case 2: return from_vk(109);
+                case 3: return from_vk(107);
+                case 4: return from_vk(108);
+                case 6: return from_vk(106);
+                case 10: return from_vk(97);
+                case 11: return from_vk(91);
+                case 12: return from_vk(95);
+                case 13: return from_vk(92);
+                case 14: return from_vk(96);
+                case 16: return from_vk(103);
+                case 28: return from_vk(37);
+                case 29: return from_vk(43);
+                case 30: return from_vk(41);
+                case 31: return from_vk(38);
+                case 32: return from_vk(42);
+                case 34: return from_vk(83);
+                case 35: return from_vk(77);
+                case 41: return from_vk(100);
+                case 49: return from_vk(16);
+                case 54: return from_vk(76);
+                case 56: return from_vk(70);
+                case 61: return from_vk(9);
+                case 71: return from_vk(133);
+                case 72: return from_vk(134);
+                case 74: return from_vk(135);
+                case 75: return from_vk(136);
+                case 77: return from_vk(137);
+                case 78: return from_vk(138);
+                case 80: return from_vk(139);
+                case 81: return from_vk(140);
+                case 83: return from_vk(141);
+                case 84: return from_vk(142);
+                case 87: return from_vk(44);
+                case 91: return from_vk(50);
+                case 95: return from_vk(143);
+                case 96: return from_vk(144);
+                case 98: return from_vk(145);
+                case 99: return from_vk(146);
+            }
+            return file_format();
+        }
+
+        inline uint32_t fourcc(const char * c) {
+            return uint32_t(uint8_t(c[0])) | (uint32_t(uint8_t(c[1])) << 8) | (uint32_t(uint8_t(c[2])) << 16) | (uint32_t(uint8_t(c[3])) << 24);
+        }
+
+        // legacy DDS pixel format
+        file_format from_dds(uint32_t flags, uint32_t code, uint32_t bits, uint32_t rmask, uint32_t gmask, uint32_t bmask, uint32_t amask) {
+            if (flags & 0x4) { // fourcc
+                if (code == fourcc("DXT1")) return from_vk(133);
+                if (code == fourcc("DXT2") || code == fourcc("DXT3")) return from_vk(135);
+                if (code == fourcc("DXT4") || code == fourcc("DXT5")) return from_vk(137);
+                if (code == fourcc("ATI1") || code == fourcc("BC4U")) return from_vk(139);
+                if (code == fourcc("BC4S")) return from_vk(140);
+                if (code == fourcc("ATI2") || code == fourcc("BC5U")) return from_vk(141);
+                if (code == fourcc("BC5S")) return from_vk(142);
+                switch (code) { // D3DFORMAT codes
+                    case 36: return from_vk(91);
+                    case 111: return from_vk(76);
+                    case 112: return from_vk(83);
+                    case 113: return from_vk(97);
+                    case 114: return from_vk(100);
+                    case 115: return from_vk(103);
+                    case 116: return from_vk(109);
+                }
+                return file_format();
+            }
+            if (flags & 0x40) { // rgb
+                if (bits == 32 && rmask == 0x000000ff && gmask == 0x0000ff00 && bmask == 0x00ff0000) return from_vk(37);
+                if (bits == 32 && rmask == 0x00ff0000 && gmask == 0x0000ff00 && bmask == 0x000000ff) return from_vk(44);
+                if (bits == 24 && rmask == 0x000000ff && gmask == 0x0000ff00 && bmask == 0x00ff0000) return from_vk(23);
+                if (bits == 24 && rmask == 0x00ff0000 && gmask == 0x0000ff00 && bmask == 0x000000ff) return file_format(GL_RGB8, GL_BGR, GL_UNSIGNED_BYTE, 3);
+                if (bits == 32 && rmask == 0x0000ffff && gmask == 0xffff0000 && amask == 0) return from_vk(77);
+            }
+            if (flags & 0x20000) { // luminance
+                if (bits == 8) return from_vk(9);
+                if (bits == 16 && amask == 0) return from_vk(70);
+                if (bits == 16 && amask == 0xff00) return from_vk(16);
+            }
+            return file_format();
+        }
+    };
+
+
+    // level (and layer range) of mapped file, uploaded by single call
+    struct texture_file_region {
+        GLint level = 0;
+        GLint layer = 0; // first array layer-face
+        GLsizei layers = 1; // count of layer-faces
+        glm::uvec3 extent = glm::uvec3(1); // level size (z is depth of 3D textures)
+        const uint8_t * data = nullptr;
+        size_t size = 0;
+    };
+
+
+    // KTX2 and DDS texture container, pixels are read straight from file mapping
+    class texture_file {
+    protected:
+        mapped_file file;
+        file_format pixel;
+        _texture_context * gltarget = nullptr;
+        glm::uvec3 base_extent = glm::uvec3(1);
+        GLint dimensions = 2;
+        GLsizei level_count = 1; // stored in file
+        bool generate_levels = false; // KTX2 levelCount 0, rest of chain is generated on create
+        GLsizei layer_count = 0; // zero is not array
+        GLsizei face_count = 1;
+        std::vector<texture_file_region> region_list;
+        std::vector<std::vector<uint8_t>> decoded; // supercompressed levels only
+        std::string log;
+
+        static uint32_t read32(const uint8_t * ptr) {
+            uint32_t v; std::memcpy(&v, ptr, 4); return v;
+        }
+
+        static uint64_t read64(const uint8_t * ptr) {
+            uint64_t v; std::memcpy(&v, ptr, 8); return v;
+        }
+
+        bool fail(const std::string& message) {
+            log = message;
+            region_list.clear();
+            decoded.clear();
+            file.close();
+            return false;
+        }
+
+        glm::uvec3 level_extent(GLint level) const {
+            return glm::max(base_extent >> glm::uvec3(level), glm::uvec3(1));
+        }
+
+        GLsizei layer_faces() const {
+            return std::max(layer_count, GLsizei(1)) * face_count;
+        }
+
+        // select texture target and validate dimensions
+        bool resolve_target() {
+            if (base_extent.x == 0 || base_extent.y == 0 || base_extent.z == 0) return fail("zero texture extent");
+            if (face_count != 1 && face_count != 6) return fail("unsupported face count");
+            if (face_count == 6 && (base_extent.x != base_extent.y || base_extent.z != 1)) return fail("cube faces are not square");
+            if (pixel.format.compressed() && dimensions != 2) return fail("compressed textures must be 2D");
+
+            GLuint max_extent = std::max(base_extent.x, std::max(base_extent.y, base_extent.z));
+            GLsizei max_levels = 1;
+            while (max_extent >>= 1) max_levels++;
+            if (level_count < 1 || level_count > max_levels) return fail("invalid level count");
+
+            const bool array = layer_count > 0;
+            if (face_count == 6) gltarget = array ? &texture_target::texture_cube_array : &texture_target::texture_cube;
+            else if (dimensions == 3) gltarget = array ? nullptr : &texture_target::texture3d;
+            else if (dimensions == 2) gltarget = array ? &texture_target::texture2d_array : &texture_target::texture2d;
+            else gltarget = array ? &texture_target::texture1d_array : &texture_target::texture1d;
+            if (!gltarget) return fail("3D texture arrays are not supported");
+            return true;
+        }
+
+        bool load_ktx2() {
+            static const uint8_t identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+            const uint8_t * ptr = file.data();
+            if (!file.contains(0, 80) || std::memcmp(ptr, identifier, 12) != 0) return fail("not a KTX2 file");
+
+            const uint32_t vk_format = read32(ptr + 12);
+            base_extent = glm::uvec3(read32(ptr + 20), std::max(read32(ptr + 24), 1u), std::max(read32(ptr + 28), 1u));
+            layer_count = GLsizei(read32(ptr + 32));
+            face_count = GLsizei(read32(ptr + 36));
+            level_count = GLsizei(std::max(read32(ptr + 40), 1u)); // zero requests runtime generation, one is stored
+            generate_levels = read32(ptr + 40) == 0;
+            const uint32_t scheme = read32(ptr + 44);
+            dimensions = read32(ptr + 28) ? 3 : read32(ptr + 24) ? 2 : 1;
+
+            pixel = file_formats::from_vk(vk_format);
+            if (!pixel.valid()) return fail("unsupported vkFormat " + std::to_string(vk_format));
+            if (!resolve_target()) return false;
+
+            supercompression::decoder decode;
+            if (scheme == 1) return fail("BasisLZ supercompression is not supported, transcode to a GPU format first");
+            if (scheme != supercompression::none) {
+                auto found = supercompression::decoders().find(scheme);
+                if (found == supercompression::decoders().end()) return fail("no decoder for supercompression scheme " + std::to_string(scheme));
+                decode = found->second;
+            }
+            if (!file.contains(80, uint64_t(level_count) * 24)) return fail("truncated level index");
+
+            std::vector<size_t> pending;
+            for (GLint level = 0; level < level_count; level++) {
+                const uint8_t * entry = ptr + 80 + level * 24;
+                const uint64_t offset = read64(entry), length = read64(entry + 8), unpacked = read64(entry + 16);
+                if (!file.contains(offset, length)) return fail("level " + std::to_string(level) + " out of file bounds");
+
+                texture_file_region region;
+                region.level = level;
+                region.layer = 0;
+                region.layers = layer_faces();
+                region.extent = level_extent(level);
+                region.size = pixel.image_size(region.extent) * size_t(region.layers);
+
+                if (scheme == supercompression::none) {
+                    if (length != region.size) return fail("level " + std::to_string(level) + " has unexpected size");
+                    region.data = ptr + offset;
+                } else {
+                    if (unpacked != region.size) return fail("level " + std::to_string(level) + " has unexpected size");
+                    pending.push_back(region_list.size());
+                }
+                region_list.push_back(region);
+            }
+
+            // decode supercompressed levels in parallel
+            if (!pending.empty()) {
+                decoded.resize(pending.size());
+                std::vector<uint8_t> ok(pending.size(), 0);
+                default_pool().parallel_for(0, pending.size(), 1, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; i++) {
+                        texture_file_region& region = region_list[pending[i]];
+                        const uint8_t * entry = ptr + 80 + region.level * 24;
+                        decoded[i].resize(region.size);
+                        ok[i] = decode(ptr + read64(entry), size_t(read64(entry + 8)), decoded[i].data(), region.size);
+                        region.data = decoded[i].data();
+                    }
+                });
+                for (size_t i = 0; i < pending.size(); i++) {
+                    if (!ok[i]) return fail("failed to decode level " + std::to_string(region_list[pending[i]].level));
+                }
+            }
+            return true;
+        }
+
+        bool load_dds() {
+            const uint8_t * ptr = file.data();
+            if (!file.contains(0, 128) || read32(ptr) != file_formats::fourcc("DDS ") || read32(ptr + 4) != 124) return fail("not a DDS file");
+
+            const uint32_t flags = read32(ptr + 8);
+            const uint32_t caps2 = read32(ptr + 112);
+            const uint32_t pf_flags = read32(ptr + 80), code = read32(ptr + 84);
+            base_extent = glm::uvec3(read32(ptr + 16), std::max(read32(ptr + 12), 1u), (flags & 0x800000) ? std::max(read32(ptr + 24), 1u) : 1u);
+            level_count = (flags & 0x20000) ? GLsizei(std::max(read32(ptr + 28), 1u)) : 1;
+            layer_count = 0;
+            face_count = (caps2 & 0x200) ? 6 : 1;
+            dimensions = (caps2 & 0x200000) ? 3 : 2;
+
+            size_t offset = 128;
+            if ((pf_flags & 0x4) && code == file_formats::fourcc("DX10")) {
+                if (!file.contains(128, 20)) return fail("truncated DX10 header");
+                pixel = file_formats::from_dxgi(read32(ptr + 128));
+                const uint32_t dimension = read32(ptr + 132), misc = read32(ptr + 136), array_size = read32(ptr + 140);
+                dimensions = dimension == 4 ? 3 : dimension == 2 ? 1 : 2;
+                if (dimensions < 3) base_extent.z = 1;
+                if (dimensions < 2) base_extent.y = 1;
+                face_count = (misc & 0x4) ? 6 : 1;
+                layer_count = array_size > 1 ? GLsizei(array_size) : 0;
+                offset = 148;
+                if (!pixel.valid()) return fail("unsupported DXGI format " + std::to_string(read32(ptr + 128)));
+            } else {
+                pixel = file_formats::from_dds(pf_flags, code, read32(ptr + 88), read32(ptr + 92), read32(ptr + 96), read32(ptr + 100), read32(ptr + 104));
+                if (!pixel.valid()) return fail("unsupported DDS pixel format");
+            }
+            if (!resolve_target()) return false;
+
+            // DDS stores whole mip chain of each layer-face in sequence
+            for (GLint layer = 0; layer < layer_faces(); layer++) {
+                for (GLint level = 0; level < level_count; level++) {
+                    texture_file_region region;
+                    region.level = level;
+                    region.layer = layer;
+                    region.layers = 1;
+                    region.extent = level_extent(level);
+                    region.size = pixel.image_size(region.extent);
+                    if (!file.contains(offset, region.size)) return fail("truncated pixel data");
+                    region.data = ptr + offset;
+                    offset += region.size;
+                    region_list.push_back(region);
+                }
+            }
+            return true;
+        }
+
+    public:
+        texture_file() {}
+        texture_file(const std::string& path) { this->load(path); }
+
+        // map file and validate headers, container is detected by signature
+        bool load(const std::string& path) {
+            region_list.clear();
+            decoded.clear();
+            log.clear();
+            generate_levels = false;
+            if (!file.open(path)) return fail("cannot map " + path);
+            if (file.contains(0, 4) && read32(file.data()) == file_formats::fourcc("DDS ")) return load_dds();
+            return load_ktx2();
+        }
+
+        bool valid() const {
+            return file.is_open() && !region_list.empty();
+        }
+
+        std::string info_log() const {
+            return log;
+        }
+
+        const _internal_format& format() const {
+            return pixel.format;
+        }
+
+        // texture2d when load failed before target was known
+        _texture_context& target() const {
+            return gltarget ? *gltarget : texture_target::texture2d;
+        }
+
+        glm::uvec3 extent() const {
+            return base_extent;
+        }
+
+        // stored levels
+        GLsizei levels() const {
+            return level_count;
+        }
+
+        // levels of created texture, full chain when file asks for generation
+        GLsizei texture_levels() const {
+            if (!generate_levels) return level_count;
+            GLuint max_extent = std::max(base_extent.x, std::max(base_extent.y, dimensions == 3 ? base_extent.z : 1u));
+            GLsizei count = 1;
+            while (max_extent >>= 1) count++;
+            return count;
+        }
+
+        bool generates_mipmaps() const {
+            return generate_levels;
+        }
+
+        GLsizei layers() const {
+            return layer_count;
+        }
+
+        GLsizei faces() const {
+            return face_count;
+        }
+
+        const std::vector<texture_file_region>& regions() const {
+            return region_list;
+        }
+
+        // immutable storage matching file (texture must be of target()), texture_levels() levels
+        void storage(texture& tex) const {
+            const GLsizei count = layer_faces();
+            const GLsizei levels = texture_levels();
+            switch ((GLenum)target()) {
+                case GL_TEXTURE_1D: tex.storage(levels, pixel.format, GLsizei(base_extent.x)); break;
+                case GL_TEXTURE_1D_ARRAY: tex.storage(levels, pixel.format, glm::uvec2(base_extent.x, count)); break;
+                case GL_TEXTURE_2D:
+                case GL_TEXTURE_CUBE_MAP: tex.storage(levels, pixel.format, glm::uvec2(base_extent)); break;
+                case GL_TEXTURE_3D: tex.storage(levels, pixel.format, base_extent); break;
+                default: tex.storage(levels, pixel.format, glm::uvec3(base_extent.x, base_extent.y, count)); break;
+            }
+        }
+
+        // upload single region from mapping without intermediate copies
+        void upload(texture& tex, const texture_file_region& region) const {
+            const GLenum fmt = pixel.format.internal();
+            const GLsizei bytes = GLsizei(region.size);
+            const bool compressed = pixel.format.compressed();
+            auto level = tex.level(region.level);
+            switch ((GLenum)target()) {
+                case GL_TEXTURE_1D:
+                    level.subimage(0, region.extent.x, pixel.format.format(), pixel.format.type(), region.data);
+                    break;
+                case GL_TEXTURE_1D_ARRAY:
+                    level.subimage(glm::ivec2(0, region.layer), glm::uvec2(region.extent.x, region.layers), pixel.format.format(), pixel.format.type(), region.data);
+                    break;
+                case GL_TEXTURE_2D:
+                    if (compressed) level.compressed_subimage(glm::ivec2(0), glm::uvec2(region.extent), fmt, bytes, region.data);
+                    else level.subimage(glm::ivec2(0), glm::uvec2(region.extent), pixel.format.format(), pixel.format.type(), region.data);
+                    break;
+                case GL_TEXTURE_3D:
+                    level.subimage(glm::ivec3(0), region.extent, pixel.format.format(), pixel.format.type(), region.data);
+                    break;
+                default: // cube, cube array, 2D array (layer-faces on z)
+                    glm::uvec3 size(region.extent.x, region.extent.y, region.layers);
+                    if (compressed) level.compressed_subimage(glm::ivec3(0, 0, region.layer), size, fmt, bytes, region.data);
+                    else level.subimage(glm::ivec3(0, 0, region.layer), size, pixel.format.format(), pixel.format.type(), region.data);
+                    break;
+            }
+        }
+
+        // stream all levels and layers into texture
+        void upload(texture& tex) const {
+            GLint alignment = 4;
+            glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // container rows are tightly packed
+            for (auto& region : region_list) this->upload(tex, region);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+        }
+
+        // create texture with storage and contents of file, empty texture (name 0) when not valid (see info_log)
+        texture create() const {
+            if (!this->valid()) {
+                GLuint none = 0;
+                return texture(target(), &none);
+            }
+            texture tex(target());
+            this->storage(tex);
+            this->upload(tex);
+            if (generate_levels) tex.generate_mipmap();
+            return tex;
+        }
+    };
+
+};
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "enums.hpp"
+#include "texture.hpp"
+#include <unordered_map>
+#include <vector>
+#include <deque>
+#include <functional>
+
+namespace NS_NAME {
+
+    // immutable storage description, pool key
+    struct texture_desc {
+        GLenum target = GL_TEXTURE_2D;
+        GLenum internal = GL_RGBA8;
+        glm::uvec3 size = glm::uvec3(1);
+        GLsizei levels = 1;
+        GLsizei samples = 0; // zero for single sampled targets
+
+        bool operator==(const texture_desc& another) const {
+            return target == another.target && internal == another.internal && size == another.size && levels == another.levels && samples == another.samples;
+        }
+    };
+
+    struct texture_desc_hash {
+        size_t operator()(const texture_desc& desc) const {
+            size_t h = std::hash<GLenum>()(desc.target);
+            auto mix = [&h](size_t v) { h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2); };
+            mix(desc.internal);
+            mix(desc.size.x);
+            mix(desc.size.y);
+            mix(desc.size.z);
+            mix(size_t(desc.levels));
+            mix(size_t(desc.samples));
+            return h;
+        }
+    };
+
+
+    struct texture_pool_stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t textures_held = 0; // free and in use
+        size_t bytes_held = 0;
+        size_t bytes_in_use = 0;
+
+        double hit_rate() const {
+            return (hits + misses) ? double(hits) / double(hits + misses) : 0.0;
+        }
+    };
+
+
+    // transient (frame scoped) texture pool, reuses immutable storage of same description
+    class texture_pool {
+    protected:
+        struct entry {
+            texture tex;
+            texture_desc desc;
+            uint64_t last_used;
+
+            entry(texture&& tex, const texture_desc& desc, uint64_t last_used) : tex(std::move(tex)), desc(desc), last_used(last_used) {}
+            entry(entry&& another) : tex(std::move(another.tex)), desc(another.desc), last_used(another.last_used) {}
+        };
+
+        std::unordered_map<texture_desc, std::deque<entry>, texture_desc_hash> free_list; // least recently used first
+        std::vector<entry> in_use;
+        std::unordered_map<GLenum, size_t> texel_bits;
+        texture_pool_stats counters;
+        uint64_t frame = 0;
+        uint64_t max_age = 3;
+
+        static _texture_context& context_of(GLenum target) {
+            switch (target) {
+                case GL_TEXTURE_1D: return texture_target::texture1d;
+                case GL_TEXTURE_1D_ARRAY: return texture_target::texture1d_array;
+                case GL_TEXTURE_2D_ARRAY: return texture_target::texture2d_array;
+                case GL_TEXTURE_3D: return texture_target::texture3d;
+                case GL_TEXTURE_CUBE_MAP: return texture_target::texture_cube;
+                case GL_TEXTURE_CUBE_MAP_ARRAY: return texture_target::texture_cube_array;
+                case GL_TEXTURE_2D_MULTISAMPLE: return texture_target::texture2d_msaa;
+                case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: return texture_target::texture2d_msaa_array;
+            }
+            return texture_target::texture2d;
+        }
+
+        // bits per texel from driver (cached), compressed by block size
+        size_t bits_of(GLenum internal) {
+            auto found = texel_bits.find(internal);
+            if (found != texel_bits.end()) return found->second;
+
+            size_t bits = size_t(_internal_format(internal).block_bytes()) * 8 / 16;
+            if (!bits) {
+                static const GLenum pnames[] = {
+                    GL_INTERNALFORMAT_RED_SIZE, GL_INTERNALFORMAT_GREEN_SIZE, GL_INTERNALFORMAT_BLUE_SIZE, GL_INTERNALFORMAT_ALPHA_SIZE,
+                    GL_INTERNALFORMAT_DEPTH_SIZE, GL_INTERNALFORMAT_STENCIL_SIZE, GL_INTERNALFORMAT_SHARED_SIZE
+                };
+                for (GLenum pname : pnames) {
+                    GLint value = 0;
+                    glGetInternalformativ(GL_TEXTURE_2D, internal, pname, 1, &value);
+                    bits += size_t(value);
+                }
+            }
+            texel_bits[internal] = bits;
+            return bits;
+        }
+
+        size_t bytes_of(const texture_desc& desc) {
+            const size_t bits = bits_of(desc.internal);
+            const bool layered = desc.target == GL_TEXTURE_1D_ARRAY || desc.target == GL_TEXTURE_2D_ARRAY || desc.target == GL_TEXTURE_CUBE_MAP_ARRAY || desc.target == GL_TEXTURE_2D_MULTISAMPLE_ARRAY;
+            size_t texels = 0;
+            glm::uvec3 size = desc.size;
+            for (GLsizei level = 0; level < desc.levels; level++) {
+                texels += size_t(size.x) * size_t(size.y) * size_t(size.z);
+                size = glm::max(size / 2u, glm::uvec3(1));
+                if (desc.target == GL_TEXTURE_1D_ARRAY) size.y = desc.size.y;
+                if (layered && desc.target != GL_TEXTURE_1D_ARRAY) size.z = desc.size.z;
+            }
+            if (desc.target == GL_TEXTURE_CUBE_MAP) texels *= 6;
+            return texels * bits * size_t(std::max(desc.samples, GLsizei(1))) / 8;
+        }
+
+        texture allocate(const texture_desc& desc) {
+            texture tex(context_of(desc.target));
+            const _internal_format format(desc.internal);
+            switch (desc.target) {
+                case GL_TEXTURE_1D: tex.storage(desc.levels, format, GLsizei(desc.size.x)); break;
+                case GL_TEXTURE_1D_ARRAY:
+                case GL_TEXTURE_2D:
+                case GL_TEXTURE_CUBE_MAP: tex.storage(desc.levels, format, glm::uvec2(desc.size)); break;
+                case GL_TEXTURE_2D_MULTISAMPLE: tex.storage_multisample(desc.samples, format, glm::uvec2(desc.size)); break;
+                case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: tex.storage_multisample(desc.samples, format, desc.size); break;
+                default: tex.storage(desc.levels, format, desc.size); break;
+            }
+            return tex;
+        }
+
+    public:
+        // textures unused for more than max_age frames are deleted
+        texture_pool(uint64_t max_age = 3) : max_age(max_age) {}
+
+        // texture valid until next_frame(), contents are undefined
+        texture acquire(const texture_desc& desc) {
+            auto found = free_list.find(desc);
+            if (found != free_list.end() && !found->second.empty()) {
+                counters.hits++;
+                in_use.emplace_back(std::move(found->second.back()));
+                found->second.pop_back();
+                counters.bytes_in_use += bytes_of(desc);
+            } else {
+                counters.misses++;
+                in_use.emplace_back(allocate(desc), desc, frame);
+                const size_t bytes = bytes_of(desc);
+                counters.textures_held++;
+                counters.bytes_held += bytes;
+                counters.bytes_in_use += bytes;
+            }
+            in_use.back().last_used = frame;
+            return texture(in_use.back().tex);
+        }
+
+        texture acquire(_texture_context& target, const _internal_format& format, glm::uvec3 size, GLsizei levels = 1, GLsizei samples = 0) {
+            texture_desc desc;
+            desc.target = target;
+            desc.internal = format.internal();
+            desc.size = size;
+            desc.levels = levels;
+            desc.samples = samples;
+            return this->acquire(desc);
+        }
+
+        texture acquire(_texture_context& target, const _internal_format& format, glm::uvec2 size, GLsizei levels = 1, GLsizei samples = 0) {
+            return this->acquire(target, format, glm::uvec3(size, 1), levels, samples);
+        }
+
+        // frame boundary: returns frame textures to pool and evicts aged ones
+        void next_frame() {
+            for (auto& used : in_use) {
+                free_list[used.desc].emplace_back(std::move(used));
+            }
+            in_use.clear();
+            counters.bytes_in_use = 0;
+
+            for (auto it = free_list.begin(); it != free_list.end();) {
+                auto& entries = it->second;
+                while (!entries.empty() && frame - entries.front().last_used >= max_age) {
+                    counters.evictions++;
+                    counters.textures_held--;
+                    counters.bytes_held -= bytes_of(entries.front().desc);
+                    entries.pop_front();
+                }
+                it = entries.empty() ? free_list.erase(it) : std::next(it);
+            }
+            frame++;
+        }
+
+        // release all free textures (used ones are kept until next_frame)
+        void trim() {
+            for (auto& pair : free_list) {
+                for (auto& e : pair.second) {
+                    counters.textures_held--;
+                    counters.bytes_held -= bytes_of(e.desc);
+                }
+            }
+            free_list.clear();
+        }
+
+        texture_pool_stats stats() const {
+            return counters;
+        }
+
+        void reset_stats() {
+            counters.hits = counters.misses = counters.evictions = 0;
+        }
+    };
+
+};
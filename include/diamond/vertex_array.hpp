@@ -69,6 +69,7 @@ namespace NS_NAME {
     };
 
 
+    // not pooled: vertex arrays are container objects, names are valid only on creating context (see gl_worker)
     class vertex_array_builder {
     public:
         static void create(GLuint * heap) {
@@ -77,6 +78,9 @@ namespace NS_NAME {
         static void release(GLuint * heap) {
             glDeleteVertexArrays(1, heap);
         };
+        static void release_n(GLsizei n, const GLuint * heap) {
+            glDeleteVertexArrays(n, heap);
+        }
     };
 
 
@@ -105,6 +109,16 @@ namespace NS_NAME {
         void element_buffer(buffer& buf){
             glVertexArrayElementBuffer(thisref, buf);
         }
+
+        // binding with runtime stride (formats known only at load time)
+        void vertex_buffer(GLuint binding, buffer& buf, GLintptr offset, GLsizei stride) {
+            glVertexArrayVertexBuffer(thisref, binding, buf, offset, stride);
+        }
+
+        // 0 per vertex, n advances every n instances
+        void binding_divisor(GLuint binding, GLuint divisor) {
+            glVertexArrayBindingDivisor(thisref, binding, divisor);
+        }
     };
 
 